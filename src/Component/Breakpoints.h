@@ -0,0 +1,97 @@
+#ifndef BREAKPOINTS_H
+#define BREAKPOINTS_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Register.h"
+#include "Memory.h"
+
+/* Access of an entry, watchpoints use the WATCH_* page flags of Memory */
+#define BREAK_EXECUTE 0
+#define BREAK_READ WATCH_READ
+#define BREAK_WRITE WATCH_WRITE
+
+/* Bitmap words over the address space */
+#define BREAK_MAP_SIZE (0x10000 / 64)
+
+/*
+    Breakpoints and watchpoints of the debugger. Breakpoints are looked up in
+    a bitmap over the 64KB address space, the CPU only tests it while any are
+    set. Watchpoints flag their 256 byte pages in Memory, so accesses to other
+    pages are not slowed down. Entries in 0x4000-0x7FFF can be restricted to a
+    ROM bank, and every entry can have a condition on a register or a byte:
+    "[bank:]start[-end] [if operand op value]", i.e. "3:4100 if a==12" or
+    "c000-c0ff if (ff44)>=90", all numbers hexadecimal.
+*/
+class Breakpoints {
+private:
+	enum Operand { OP_NONE, OP_A, OP_F, OP_B, OP_C, OP_D, OP_E, OP_H, OP_L, OP_AF, OP_BC, OP_DE, OP_HL, OP_SP, OP_MEMORY };
+	enum Comparison { CMP_EQ, CMP_NE, CMP_LT, CMP_LE, CMP_GT, CMP_GE };
+
+	struct Entry {
+		int id;
+		uint16_t start;
+		uint16_t end;
+
+		/* ROM bank for addresses in 0x4000-0x7FFF, -1 for any */
+		int bank;
+
+		/* BREAK_EXECUTE or BREAK_READ and BREAK_WRITE bits */
+		uint8_t access;
+
+		/* Removed on the first hit, for the gt and gg commands */
+		bool temporary;
+
+		Operand operand;
+		Comparison comparison;
+		uint16_t address;
+		uint16_t value;
+	};
+
+	Memory* mem;
+	registers* reg;
+
+	std::vector<Entry> entries;
+	int nextId;
+
+	/* One bit per address with a breakpoint, armed when any is set */
+	uint64_t executeMap[BREAK_MAP_SIZE];
+	bool armed;
+
+	bool parse(const std::string& spec, Entry& entry);
+	bool matches(const Entry& entry, uint16_t addr);
+	uint16_t getOperand(const Entry& entry);
+	bool checkExecute(uint16_t pc);
+
+	/* Rebuild the bitmap and the watched pages of Memory */
+	void update();
+	void print(const Entry& entry);
+
+public:
+	/* Constructor and Destructor */
+	Breakpoints(Memory* m, registers* r);
+	~Breakpoints();
+
+	/* Add an entry from its text form, returns its id or -1 when the text is invalid */
+	int add(const std::string& spec, uint8_t access = BREAK_EXECUTE, bool temporary = false);
+	bool remove(int id);
+	void clear();
+	void list();
+
+	/* true, when any breakpoint is set */
+	bool isArmed() {
+		return armed;
+	}
+
+	/* true, when the instruction at pc hits a breakpoint */
+	bool isHit(uint16_t pc) {
+		return ((executeMap[pc >> 6] >> (pc & 63)) & 1) && checkExecute(pc);
+	}
+
+	/* Called by Memory for accesses to watched pages, stops in the debugger on a hit */
+	void onAccess(uint16_t addr, uint8_t value, uint8_t access);
+};
+
+#endif /* BREAKPOINTS_H */
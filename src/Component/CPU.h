@@ -16,8 +16,22 @@
 #include "Memory.h"
 #include "Timer.h"
 #include "GPU.h"
+#include "Joypad.h"
+#include "SaveState.h"
+#include "Rewind.h"
+#include "Profiler.h"
+#include "Stats.h"
+#include "Breakpoints.h"
+#include "CodeLog.h"
 
-#define CLOCK_RATE 4194304
+/* CPU ticks per emulated frame (154 scanlines * 456 ticks) */
+#define TICKS_PER_FRAME 70224
+
+/* Remaining host time before a pacing deadline spent spinning, since sleep is too coarse */
+#define PACING_SPIN_NS 1000000
+
+/* Resynchronize pacing instead of catching up, when more than this behind */
+#define PACING_MAX_LAG_NS 100000000
 
 using std::string;
 
@@ -28,29 +42,145 @@ private:
 	Memory* mem;
 	Timer* timer;
 	GPU* gpu;
+	Joypad* joypad;
 	uint8_t ext;
 	bool interruptsEnabled;
 	bool isHalt;
 
+	/* false, when started without boot ROM */
+	bool bootROM;
+
 	std::chrono::steady_clock::time_point start;
 	unsigned long globalTicks;
 
+	/* Frame pacing: ticks at start and at the next pacing deadline */
+	unsigned long startTicks;
+	unsigned long paceTicks;
+	double paceSpeed;
+
+	/* Host time the current frame started, for tracing */
+	uint64_t traceStart;
+
+	/* Reused for save states from the hotkeys */
+	std::vector<uint8_t> stateBuffer;
+
+	/* Snapshot history per frame, NULL when rewinding is disabled */
+	Rewind* rewind;
+	std::vector<uint8_t> rewindBuffer;
+
+	/* Run-ahead: state of the shown frame, last real frame and time spent ahead */
+	std::vector<uint8_t> aheadBuffer;
+	bool runningAhead;
+	unsigned long aheadFrame;
+	unsigned long aheadRuns;
+	std::chrono::steady_clock::duration aheadTime;
+
+	/* Bank switches of the frames run ahead, left out of the statistics */
+	unsigned long aheadBankSwitches;
+
+	/* Input movie, NULL when off, and host time it started */
+	Movie* movie;
+	std::chrono::steady_clock::time_point movieStart;
+
+	/* Frames and input for other processes, NULL when off */
+	SharedFrame* sharedFrame;
+
+	/* Video output of the rendered frames, NULL when off */
+	VideoWriter* video;
+
+	/* Hashes of the rendered frames, NULL when off */
+	FrameLog* frameLog;
+
+	/* Guest code profile, NULL when off */
+	Profiler* profiler;
+
+	/* Code/data log of the cartridge, NULL when off */
+	CodeLog* codeLog;
+
+	/* Performance statistics, NULL when off */
+	Stats* stats;
+	unsigned long instructions;
+
+	/* Breakpoints and watchpoints of the debugger */
+	Breakpoints* breakpoints;
 
 public:
 	/* Constrcutor */
-	CPU(Memory* m);
+	CPU(Memory* m, bool headless = false);
+	~CPU();
 
 	/* Main Methods */
-	void run();
+	void initialize();
+
+	/* false, when the run could not start or frames differ from the golden log */
+	bool run();
+
+	/* Run until the next frame is finished */
+	void runFrame();
 	void disassemble();
 	void readRomHeader();
 	string getRomName();
 
+	GPU* getGPU();
+	Joypad* getJoypad();
+
 /* Util Methods */
 
 	void exec();
 	void wait();
 
+	/* Sleep until the deadline of the frame, true when it was already missed */
+	bool pace();
+	void publishStats();
+
+	/* Main loop and instruction, instrumentation by profiler or code log is decided once so the normal path has no checks */
+	template <bool instrumented> void loop();
+	template <bool instrumented> void execute();
+
+	/* Profile an executed instruction, sp is the stack pointer before it */
+	uint32_t getProfileLocation(uint16_t pc);
+	void profileInstruction(uint16_t opcode, uint32_t location, uint16_t sp, uint8_t ticks);
+	void writeProfile();
+
+	/* Log the bytes of the next instruction as code */
+	void logInstruction();
+	void writeCodeLog();
+	void resetPacing();
+
+	/* Save State of the whole machine, except the ROM */
+	void saveState(StateWriter& w);
+	void loadState(StateReader& r);
+
+	/* Save State with header and checksum, nothing is loaded unless the payload fits the machine */
+	void saveState(std::vector<uint8_t>& buffer);
+	bool loadState(const std::vector<uint8_t>& buffer);
+
+	/* Payload size of the current machine, fixed per cartridge */
+	size_t getStateSize();
+
+	void handleStateRequest(uint8_t request);
+
+	/* Skip the boot ROM */
+	void setBootROM(bool present);
+	void initializePostBoot();
+	string getBootCacheFile();
+	bool loadBootCache();
+	void storeBootCache();
+
+	/* Input movie recording and replay */
+	bool startMovie();
+	void finishMovie();
+
+	/* Copy the state of another CPU and its components, except Memory */
+	void copyState(const CPU& other);
+
+	/* Record a snapshot, or step back while rewinding. true, when a state was loaded */
+	bool updateRewind();
+
+	/* Emulate frames ahead and show the last one, then return to the current state */
+	void runAhead(uint8_t frames);
+	void printRunAheadStats();
+
 	/* Interrupt Methods */
 	void enableInterrupts();
 	void disableInterrupts();
@@ -98,6 +228,7 @@ public:
 	void memdumpr(uint16_t value, string name);
 	void memdumpc(uint32_t start, uint32_t end);
 	void stackdump();
+	void addBreakpoint(string spec, uint8_t access);
 
 	/* Test Methods */
 	void testEndianness();
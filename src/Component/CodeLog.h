@@ -0,0 +1,62 @@
+#ifndef CODELOG_H
+#define CODELOG_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Memory.h"
+
+/* Flags per ROM byte, the file is one byte per ROM byte in this format */
+#define CODELOG_OPCODE 0x1
+#define CODELOG_OPERAND 0x2
+#define CODELOG_DATA 0x4
+
+/* Size of a ROM bank, bank 0 is fixed at 0x0000 and the others are mapped to 0x4000 */
+#define CODELOG_BANK_SIZE 0x4000
+
+/*
+    Code/data log: marks every cartridge byte, by physical offset
+    bank * 0x4000 + (addr & 0x3FFF), as executed opcode, operand or read
+    as data. Loading an existing log merges it, so coverage adds up over
+    runs. Operands are read by the CPU like data, so reads of the bytes of
+    the current instruction are not counted as data.
+*/
+class CodeLog {
+private:
+	Memory* mem;
+	std::vector<uint8_t> flags;
+
+	/* Bytes of the current instruction */
+	uint16_t fetchStart;
+	uint16_t fetchEnd;
+
+	/* Physical offset of addr in the mapped bank, -1 outside of the cartridge */
+	long getOffset(uint16_t addr);
+
+public:
+	/* Constructor */
+	CodeLog(Memory* m);
+
+	/* Merge an existing log, true when there is none. false, when it is for another cartridge */
+	bool load(std::string file);
+	bool writeFile(std::string file);
+
+	/* Instruction of length bytes at pc, before its operands are read. Extended, pc is the byte after the CB prefix */
+	void addInstruction(uint16_t pc, uint8_t length, bool extended);
+
+	/* Called by Memory for reads of 0x0000-0x7FFF */
+	void addRead(uint16_t addr) {
+		if ((uint16_t) (addr - fetchStart) >= (uint16_t) (fetchEnd - fetchStart)) {
+			long offset = getOffset(addr);
+			if (offset >= 0) {
+				flags[offset] |= CODELOG_DATA;
+			}
+		}
+	}
+
+	/* Coverage per kind and the banks touched */
+	void printStats();
+};
+
+#endif /* CODELOG_H */
@@ -2,29 +2,153 @@
 #define CONFIG_H
 
 #include <cstdint>
+#include <cstddef>
+#include <atomic>
+#include <string>
+#include <vector>
+
+/* Save state requests, handled by the CPU between instructions */
+#define STATE_REQUEST_SAVE 0x1
+#define STATE_REQUEST_LOAD 0x2
+
+/* Input movie modes */
+#define MOVIE_OFF 0
+#define MOVIE_RECORD 1
+#define MOVIE_REPLAY 2
+
+/* Frame hash log modes */
+#define FRAMELOG_OFF 0
+#define FRAMELOG_WRITE 1
+#define FRAMELOG_VERIFY 2
 
 class Config {
 private:
     static bool debug;
 
-    static bool waiting;
-    static bool equals;
-    static uint16_t waitPc;
+    /* Breakpoints to set at start, see Breakpoints.h */
+    static std::vector<std::string> breakpoints;
 
     static bool moveToEnabled;
     static uint16_t moveToCounter;
     static uint16_t counter;
 
+    /* Render one of every frameSkip frames, 0 disables rendering */
+    static uint16_t frameSkip;
+
+    /* Emulation speed multiplier, 0 runs unlimited */
+    static double speed;
+
+    /* Index of the predefined GUI color palette */
+    static uint8_t colorPalette;
+
+    /* Set from the presenter thread */
+    static std::atomic<bool> quit;
+
+    /* Pending STATE_REQUEST_* bits */
+    static uint8_t stateRequest;
+
+    /* Memory for the rewind history in bytes, 0 disables rewinding */
+    static size_t rewindBudget;
+    static bool rewinding;
+
+    /* Frames emulated ahead of the shown one, 0 disables run-ahead */
+    static uint8_t runAhead;
+
+    /* Start from the cached state after the boot ROM */
+    static bool bootCache;
+
+    /* Input movie to record or replay */
+    static std::string movieFile;
+    static uint8_t movieMode;
+
+    /* Name of the shared memory segment for frontends, empty when off */
+    static std::string sharedFrame;
+
+    /* Video output file and VIDEO_* format, empty when off */
+    static std::string videoFile;
+    static uint8_t videoFormat;
+
+    /* Frame hash log and FRAMELOG_* mode */
+    static std::string frameLogFile;
+    static uint8_t frameLogMode;
+
+    /* Guest code profile report, empty when off */
+    static std::string profileFile;
+
+    /* Chrome trace of host timing, empty when off */
+    static std::string traceFile;
+
+    /* Code/data log of the cartridge, empty when off */
+    static std::string codeLogFile;
+
+    /* Performance statistics on screen and in a file, empty when off */
+    static bool overlay;
+    static std::string statsFile;
+
 public:
     static void enableDebug();
     static void disableDebug();
     static bool isDebug();
-    static void waitForPC(uint16_t pc, bool eq);
-    static bool isWaiting(uint16_t pc);
-    static void disableWaiting();
+    static void addBreakpoint(std::string spec);
+    static const std::vector<std::string>& getBreakpoints();
     
     static void enableCounter(uint16_t c);
     static bool isCounting();
+
+    static void setFrameSkip(uint16_t n);
+    static uint16_t getFrameSkip();
+
+    static void setSpeed(double s);
+    static double getSpeed();
+
+    static void setColorPalette(uint8_t p);
+    static uint8_t getColorPalette();
+
+    static void requestQuit();
+    static bool isQuitRequested();
+
+    static void requestState(uint8_t request);
+    static uint8_t takeStateRequest();
+
+    static void setRewindBudget(size_t bytes);
+    static size_t getRewindBudget();
+    static void setRewinding(bool r);
+    static bool isRewinding();
+
+    static void setRunAhead(uint8_t frames);
+    static uint8_t getRunAhead();
+
+    static void enableBootCache();
+    static bool isBootCacheEnabled();
+
+    static void setMovie(std::string file, uint8_t mode);
+    static std::string getMovieFile();
+    static uint8_t getMovieMode();
+
+    static void setSharedFrame(std::string name);
+    static std::string getSharedFrame();
+
+    static void setVideo(std::string file, uint8_t format);
+    static std::string getVideoFile();
+    static uint8_t getVideoFormat();
+
+    static void setFrameLog(std::string file, uint8_t mode);
+    static std::string getFrameLogFile();
+    static uint8_t getFrameLogMode();
+
+    static void setProfileFile(std::string file);
+    static std::string getProfileFile();
+
+    static void setTraceFile(std::string file);
+    static std::string getTraceFile();
+
+    static void setCodeLogFile(std::string file);
+    static std::string getCodeLogFile();
+
+    static void enableOverlay();
+    static bool isOverlayEnabled();
+    static void setStatsFile(std::string file);
+    static std::string getStatsFile();
 };
 
 #endif /* CONFIG_H */
\ No newline at end of file
@@ -0,0 +1,80 @@
+#ifndef DISASSEMBLER_H
+#define DISASSEMBLER_H
+
+#include <cstdint>
+#include <cstdio>
+#include <chrono>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+/* Size of a ROM bank, bank 0 is fixed at 0x0000 and the others are mapped to 0x4000 */
+#define DISASM_BANK_SIZE 0x4000
+
+/* Flags per ROM byte */
+#define DISASM_OPCODE 0x1
+#define DISASM_OPERAND 0x2
+#define DISASM_LABEL 0x4
+
+/* Data bytes per DB line */
+#define DISASM_DATA_PER_LINE 8
+
+/*
+    Disassembles a whole cartridge without emulating it. Code is found by
+    recursive traversal from the entry point, the RST and interrupt vectors
+    and any added entries: jumps, calls and RSTs are followed, bytes never
+    reached are written as data. Targets in 0x4000-0x7FFF are resolved in
+    the bank of the calling code, or in the bank selected by a preceding
+    "LD A, n; LD (2000-3FFF), A". Unresolved targets are only commented.
+*/
+class Disassembler {
+private:
+	/* Attributes */
+	std::vector<uint8_t> rom;
+	std::vector<uint8_t> flags;
+
+	/* Physical offsets still to trace */
+	std::vector<uint32_t> pending;
+
+	/* Resolved target of every traced jump, call and RST */
+	std::unordered_map<uint32_t, uint32_t> targets;
+
+	unsigned long instructions;
+	unsigned long labels;
+	unsigned long unresolved;
+	std::chrono::steady_clock::duration elapsed;
+
+	/* Physical offset of an address in a bank, -1 when it is outside of the ROM */
+	long getOffset(int bank, uint16_t addr);
+	uint16_t getAddress(uint32_t offset);
+	uint32_t getLength(uint32_t offset);
+
+	/* Target of a jump, call or RST at offset, false when it has none */
+	bool getTarget(uint32_t offset, uint16_t& target);
+
+	void addTarget(long offset);
+	void trace(uint32_t offset);
+
+	void writeInstruction(FILE* file, uint32_t offset);
+	uint32_t writeData(FILE* file, uint32_t offset);
+
+public:
+	/* Constructor */
+	Disassembler();
+
+	bool load(const std::string& file);
+
+	/* Additional entry point, i.e. from a code log */
+	void addEntry(uint32_t offset);
+
+	/* Every executed opcode of a code log is an entry, false when it is for another cartridge */
+	bool addCodeLog(const std::string& file);
+
+	/* Trace from the vectors and the added entries */
+	void run();
+
+	bool writeFile(const std::string& file);
+	void printStats();
+};
+
+#endif /* DISASSEMBLER_H */
@@ -0,0 +1,49 @@
+#ifndef EMULATOR_H
+#define EMULATOR_H
+
+#include <string>
+
+#include "CPU.h"
+#include "Memory.h"
+
+/*
+    A complete machine. Machines are independent of each other, only the
+    cartridge ROM is shared between clones until one of them writes to it.
+    Config is global and applies to all machines.
+*/
+class Emulator {
+private:
+	/* Attributes */
+	Memory* mem;
+	CPU* cpu;
+
+public:
+	/* Constructor and Destructor, a headless machine has no window */
+	Emulator(bool headless = false);
+	~Emulator();
+
+	/* Load the boot ROM and the cartridge */
+	void load(std::string bootRom, std::string rom);
+
+	/* false, when the run could not start or frames differ from the golden log */
+	bool run();
+
+	/* Prepare a loaded machine for runFrame, instead of run */
+	void initialize();
+	void runFrame();
+
+	/* Buttons for the next frames, one bit per Joypad::Button */
+	void setButtons(uint8_t mask);
+	const uint8_t* getFrameBuffer();
+
+	/* New headless machine in the same state */
+	Emulator* clone();
+
+	/* Copy the state of another machine, without allocating */
+	void copyFrom(const Emulator& other);
+
+	CPU* getCPU();
+	Memory* getMemory();
+};
+
+#endif /* EMULATOR_H */
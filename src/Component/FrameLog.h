@@ -0,0 +1,49 @@
+#ifndef FRAMELOG_H
+#define FRAMELOG_H
+
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include "GUI.h"
+#include "Config.h"
+
+/*
+    Hash of every rendered frame, one "<frame> <hash>" line per frame.
+    Written once as golden log, i.e. while replaying a movie, and later
+    compared against, so changes to the emulation can be checked for
+    identical output without storing any video.
+*/
+class FrameLog {
+private:
+	/* Attributes */
+	FILE* file;
+	bool verifying;
+
+	/* Golden log and the next entry to compare */
+	std::vector<std::pair<unsigned long, uint64_t> > golden;
+	size_t position;
+
+	unsigned long frames;
+	bool diverged;
+
+public:
+	/* Constructor and Destructor */
+	FrameLog();
+	~FrameLog();
+
+	/* Start writing a new log, or load the golden log to verify against, false when it is empty or malformed */
+	bool open(std::string file, uint8_t mode);
+
+	/* Log or compare a rendered frame, false at the first difference or the end of the golden log */
+	bool addFrame(uint8_t framebuffer[][WIDTH], unsigned long frame);
+
+	/* Report the result, false when the frames differ from the golden log */
+	bool finish();
+
+	/* Hashes eight bytes at once, the framebuffer size is a multiple of it */
+	static uint64_t hash(const uint8_t* data, size_t size);
+};
+
+#endif /* FRAMELOG_H */
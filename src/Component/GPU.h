@@ -2,7 +2,11 @@
 #define GPU_H
 
 #include "Memory.h"
-#include "GUI.h"
+#include "Presenter.h"
+#include "Movie.h"
+#include "SharedFrame.h"
+#include "VideoWriter.h"
+#include "FrameLog.h"
 
 #include <queue>
 
@@ -98,9 +102,47 @@ private:
     uint8_t frameBuffer[SCREEN_HEIGHT][SCREEN_WIDTH];
 
     Memory* mem;
-    GUI* gui;
+
+    /* NULL when headless, frames are then only kept in frameBuffer */
+    Presenter* presenter;
+
+    /* Input movie updated every frame, NULL when off */
+    Movie* movie;
+
+    /* Shared memory frontend, NULL when off */
+    SharedFrame* sharedFrame;
+
+    /* Video output, NULL when off */
+    VideoWriter* video;
+
+    /* Hash log of the rendered frames, NULL when off */
+    FrameLog* frameLog;
 
     //Render* render;
+
+    /* Shadow copies of the LCD registers, kept in sync by Memory on write */
+    uint8_t lcdc;
+    uint8_t stat;
+    uint8_t scrollY;
+    uint8_t scrollX;
+    uint8_t ly;
+    uint8_t lyc;
+    uint8_t bgPalette;
+    uint8_t objPalette0;
+    uint8_t objPalette1;
+    uint8_t windowY;
+    uint8_t windowX;
+
+    /* Frame skipping, renderEnabled overrides it and is not part of the state */
+    bool renderCurrentFrame;
+    bool renderEnabled;
+
+    /* Frames run ahead, only shown and streamed, the input is held. Not part of the state */
+    bool speculative;
+    unsigned long frameCounter;
+    unsigned long renderedFrames;
+    unsigned long skippedFrames;
+
     enum GPUMode{ GPU_H_BLANK = 0, GPU_V_BLANK = 1, GPU_OAM = 2, GPU_VRAM = 3 };
 
     bool isLCDenabled();
@@ -138,6 +180,8 @@ private:
     uint16_t getActiveBackgroundMemory();
     uint16_t getActiveWindowMemory();
     bool isInWindow(uint8_t x, uint8_t y);
+    bool isFrameRendered();
+    void finishFrame();
 
     void drawLine();
 
@@ -157,8 +201,8 @@ private:
     uint8_t getSpriteSizeY();
     void renderSprite();
     std::priority_queue<Sprite> getOrderedSprites();
-    uint8_t getColorPaletteFromNumber(uint8_t color, uint16_t PALETTE);
-    uint16_t getActiveColorPaletteAddress(uint8_t index);
+    uint8_t getColorPaletteFromNumber(uint8_t color, uint8_t palette);
+    uint8_t getActiveColorPalette(uint8_t index);
 
     uint8_t getSpriteLine(uint8_t index);
   
@@ -169,10 +213,56 @@ private:
 
 public:
     /* Constructor */
-    GPU(Memory* m); 
+    GPU(Memory* m, bool headless = false);
+    ~GPU();
     void update(uint8_t cycles);
 
     void handleEvents();
+
+    /* Present the current framebuffer again, i.e. after loading a state */
+    void presentFrame();
+
+    /* Text over the shown frames, ignored when headless */
+    void setOverlay(const std::string& text);
+
+    /* Called by Memory for writes to the LCD registers 0xFF40-0xFF4B */
+    void writeRegister(uint16_t addr, uint8_t value);
+
+    /* Reload all shadow registers from memory */
+    void syncRegisters();
+
+    /* Save State, shadow registers are reloaded from memory */
+    void saveState(StateWriter& w);
+    void loadState(StateReader& r);
+    void copyState(const GPU& other);
+
+    bool isHeadless();
+
+    const uint8_t* getFrameBuffer();
+
+    /* Record or replay the joypad at the end of every frame */
+    void setMovie(Movie* m);
+
+    /* Publish rendered frames and take input from other processes */
+    void setSharedFrame(SharedFrame* s);
+
+    /* Stream rendered frames */
+    void setVideoWriter(VideoWriter* v);
+
+    /* Log or verify the hash of every rendered frame, quits when verifying is done */
+    void setFrameLog(FrameLog* f);
+
+    /* Enable or disable rendering from the next line on, regardless of frame skipping */
+    void setRendering(bool enabled);
+
+    /* Run frames ahead without input, movie, shared frame or frame log */
+    void setSpeculative(bool enabled);
+    unsigned long getFrameCount();
+
+    /* Frame statistics */
+    unsigned long getRenderedFrames();
+    unsigned long getSkippedFrames();
+    void printFrameStats();
 };
 
 #endif /* GPU_H */
\ No newline at end of file
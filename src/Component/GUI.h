@@ -3,13 +3,27 @@
 
 #include <SDL2/SDL.h>
 #include <stdio.h>
+#include <string>
 
 #include "Memory.h"
+#include "Joypad.h"
 
 // Screen dimension constants
 const int WIDTH = 160;
 const int HEIGHT = 144;
 
+// Number of predefined color palettes
+const int PALETTE_COUNT = 2;
+
+/* Hotkeys handed to the emulation thread */
+#define HOTKEY_DEBUG 0x1
+#define HOTKEY_SAVE_STATE 0x2
+#define HOTKEY_LOAD_STATE 0x4
+
+/* Glyphs of the overlay font are 3x5 pixels, with one pixel spacing */
+#define OVERLAY_GLYPH_WIDTH 4
+#define OVERLAY_LINE_HEIGHT 6
+
 class GUI {
 private:
 	/* Attributes */
@@ -19,6 +33,23 @@ private:
     SDL_Window* window;
     SDL_Texture* texture;
 
+    /* RGBA lookup table for the 4 shades */
+    uint32_t palette[4];
+
+    /* Converted pixels and last presented frame to detect unchanged lines */
+    uint32_t pixels[HEIGHT][WIDTH];
+    uint8_t lastFrame[HEIGHT][WIDTH];
+    bool forceRedraw;
+
+    /* Text drawn over the top lines, one line per '\n' */
+    std::string overlay;
+    int overlayLines;
+
+    /* Pixel lines covered by the old and new text since setOverlay, 0 when unchanged */
+    int overlayDirty;
+
+    void drawOverlay();
+
     /* Button Mapping */
     SDL_Keycode buttonA;
     SDL_Keycode buttonB;
@@ -31,6 +62,18 @@ private:
     SDL_Keycode buttonX;
     SDL_Keycode buttonY;
 
+    /* Pressed buttons as bitmask of Joypad::Button */
+    uint16_t buttons;
+
+    /* Hotkeys pressed since the last call of takeHotkeys */
+    uint8_t hotkeys;
+
+    /* true, while the rewind key is held */
+    bool rewindHeld;
+
+    void pressButton(Joypad::Button b);
+    void releaseButton(Joypad::Button b);
+
 public:
 	/* Constructor and Destructor */
 	GUI();
@@ -40,7 +83,17 @@ public:
 	void render(uint8_t framebuffer[][WIDTH]);
 	uint8_t getPixelColor(uint8_t, uint8_t, uint8_t);
 	uint32_t getColor(uint8_t c);
+	void setPalette(const uint32_t colors[4]);
+
+	/* Predefined palette as RGBA8888, for output without window */
+	static const uint32_t* getPalette(uint8_t index);
+
+	/* Show text in the top left corner, empty hides it */
+	void setOverlay(const std::string& text);
 	void handleEvents();
+	uint16_t getButtons();
+	uint8_t takeHotkeys();
+	bool isRewindHeld();
 };
 
 #endif /* GUI_H */
\ No newline at end of file
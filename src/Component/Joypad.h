@@ -5,23 +5,25 @@
 
 
 class Joypad {
-private:
-	/* Private constructor to prevent instantiation of this class */
-	Joypad() {}
-
 public:
 	/* Enum */
 	enum class Button {A, B, Select, Start, Right, Left, Up, Down, X, Y};
 
-    static bool buttons[10];
+    bool buttons[10];
+
+    Memory* mem;
 
-    static Memory* mem;
+	/* Constructor */
+	Joypad(Memory* m);
 
 	/* Methods */
-	static void pressButton(Button button);
-	static void releaseButton(Button button);
-	static void triggerLayoutChange(uint8_t reg);
-	static bool isAnyButtonPressed();
+	void pressButton(Button button);
+	void releaseButton(Button button);
+	void triggerLayoutChange(uint8_t reg);
+	bool isAnyButtonPressed();
+
+	/* Press and release the eight Game Boy buttons, one bit per Button */
+	void setButtons(uint8_t mask);
 
 };
 
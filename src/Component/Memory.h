@@ -2,16 +2,63 @@
 #define MEMORY_H
 
 #include <cstdint>
+#include <memory>
+#include <vector>
 
 #define MEM_SIZE 0xFFFF+1
 #define CARTRIDGE_SIZE 0x800000+1
 #define RAM_SIZE 0x8000+1
 
+/* External RAM banks of 8KB held in ram */
+#define RAM_BANKS 4
+
+#define CLOCK_RATE 4194304
+
+/* MBC3 RTC registers, selected by writing to 0x4000-0x5FFF */
+#define RTC_SECONDS 0x08
+#define RTC_MINUTES 0x09
+#define RTC_HOURS 0x0A
+#define RTC_DAYS_LOW 0x0B
+#define RTC_DAYS_HIGH 0x0C
+#define RTC_HALT (1 << 6)
+#define RTC_CARRY (1 << 7)
+
+/* I/O registers handled by the dispatch tables */
+#define IO_START 0xFF00
+#define IO_SIZE 0x80
+
+/* OAM DMA copies 0xA0 bytes, one per M-cycle */
+#define DMA_DESTINATION 0xFE00
+#define DMA_LENGTH 0xA0
+#define DMA_TICKS (DMA_LENGTH * 4)
+
+/* Watchpoint flags of the 256 byte pages */
+#define WATCH_PAGES 0x100
+#define WATCH_READ 0x1
+#define WATCH_WRITE 0x2
+#define WATCH_LOG 0x4
+
+class GPU;
+class Timer;
+class Joypad;
+class Memory;
+class Breakpoints;
+class CodeLog;
+class StateWriter;
+class StateReader;
+
+/* Hooks for reads and writes to a single I/O register */
+typedef uint8_t (Memory::*IOReadHandler)(uint16_t addr);
+typedef void (Memory::*IOWriteHandler)(uint16_t addr, uint8_t value);
+
+/* Hook for writes to a bank register region of the ROM */
+typedef void (Memory::*BankHandler)(uint16_t addr, uint8_t value);
 
 class Memory {
 private:
 	/* Attributes */
-	uint8_t cartridge[CARTRIDGE_SIZE] = {};
+	/* Cartridge ROM, shared between clones and copied before it is written */
+	std::shared_ptr<std::vector<uint8_t> > cartridge;
 	uint8_t memory[MEM_SIZE] = {};
 	uint8_t ram[RAM_SIZE] = {};
 
@@ -27,31 +74,123 @@ private:
 	/* Select if higher two bits change RAM or ROM bank */
 	uint8_t bankMode;
 
-	/* The current romBank. This is not allowed to be 0 */
-	uint8_t romBank;
+	/* The current romBank. This is not allowed to be 0, except for MBC5 */
+	uint16_t romBank;
+
+	/* Number of ROM banks from the Cartridge Header */
+	uint16_t romBankCount;
+
+	/* Counted for the performance statistics */
+	unsigned long bankSwitches;
 	
 	/* The current ramBank. This can be 0-3 */
 	uint8_t ramBank;
 
+	/* Bank register handlers for 0x0000-0x7FFF in 8KB regions, selected by the MBC type */
+	BankHandler bankRegister[4];
+
+	/* MBC3 RTC: selected register (0 when RAM is mapped), latched registers and counted time */
+	uint8_t rtcSelect;
+	uint8_t rtcLatch;
+	uint8_t rtcRegister[5];
+	unsigned long rtcTime;
+	unsigned long rtcBase;
+
+	/* Ticks since power on */
+	unsigned long ticks;
+
+	/* GPU to notify on writes to the LCD registers */
+	GPU* gpu;
+
+	/* Timer to forward reads and writes of the timer registers */
+	Timer* timer;
+
+	/* Joypad to update on writes to the joypad register */
+	Joypad* joypad;
+
+	/* Per register handlers for 0xFF00-0xFF7F, NULL for plain memory.
+	   Timer and LCD handlers are installed when the component is attached. */
+	IOReadHandler ioRead[IO_SIZE];
+	IOWriteHandler ioWrite[IO_SIZE];
+
+	void initializeIOHandlers();
+
+	/* WATCH_* flags per page, only accesses to flagged pages call into watchpoints or the code log */
+	uint8_t watchPages[WATCH_PAGES];
+	Breakpoints* watchpoints;
+	CodeLog* codeLog;
+
+	uint8_t readUnwatched(uint16_t addr);
+	void notifyWatchpoints(uint16_t addr, uint8_t value, uint8_t access);
+
+	/* OAM DMA state */
+	bool dmaActive;
+	uint16_t dmaSource;
+	uint16_t dmaTicks;
+	uint8_t dmaCopied;
+
+	/* I/O read handlers */
+	uint8_t readSerialData(uint16_t addr);
+	uint8_t readTimer(uint16_t addr);
+	uint8_t readAudio(uint16_t addr);
+
+	/* I/O write handlers, called after the value is stored */
+	void writeJoypad(uint16_t addr, uint8_t value);
+	void writeSerialControl(uint16_t addr, uint8_t value);
+	void writeTimer(uint16_t addr, uint8_t value);
+	void writeAudio(uint16_t addr, uint8_t value);
+	void writeLCD(uint16_t addr, uint8_t value);
+	void writeScanline(uint16_t addr, uint8_t value);
+	void writeDMA(uint16_t addr, uint8_t value);
+
 public:
 	/* Constrcutor */
 	Memory();
 
+	/* Attach GPU for LCD register writes */
+	void setGPU(GPU* g);
+
+	/* Attach Timer for timer register reads and writes */
+	void setTimer(Timer* t);
+
+	/* Attach Joypad for joypad register writes */
+	void setJoypad(Joypad* j);
+	Joypad* getJoypad();
+
 	/* Bank Unit */
 	void initialize();
 
-	/* Remap ROM with Cartridge */
-	void remapUnit();
+	/* Remap ROM with Cartridge, true when the boot ROM was just unmapped */
+	bool remapUnit();
 
 	/* Select and Copy select memory bank */
 	void bankUnit(uint16_t addr, uint8_t value);
 
+	/* Select bank register handlers for the current MBC */
+	void selectMapper();
+
+	/* Switch banks into memory */
+	void switchROMBank(uint16_t bank);
+	void switchRAMBank(uint8_t bank);
+
 	/* Handle MBC Banking */
-	void handleMBC1(uint16_t addr, uint8_t value);
-	void handleMBC2(uint16_t addr, uint8_t value);
-	void handleMBC3(uint16_t addr, uint8_t value);
-	void handleMBC4(uint16_t addr, uint8_t value);
-	void handleMBC5(uint16_t addr, uint8_t value);
+	void writeNoMBC(uint16_t addr, uint8_t value);
+	void writeRAMEnable(uint16_t addr, uint8_t value);
+	void writeMBC1ROMBank(uint16_t addr, uint8_t value);
+	void writeMBC1HighBank(uint16_t addr, uint8_t value);
+	void writeMBC1Mode(uint16_t addr, uint8_t value);
+	void writeMBC2Register(uint16_t addr, uint8_t value);
+	void writeMBC3ROMBank(uint16_t addr, uint8_t value);
+	void writeMBC3RAMBank(uint16_t addr, uint8_t value);
+	void writeMBC3Latch(uint16_t addr, uint8_t value);
+	void writeMBC5ROMBank(uint16_t addr, uint8_t value);
+	void writeMBC5RAMBank(uint16_t addr, uint8_t value);
+
+	/* Handle MBC3 RTC */
+	unsigned long getRTCTime();
+	void latchRTC();
+	void mapRTC();
+	void writeRTC(uint8_t value);
 
 	/* Copy current bank to RAM */
 	void storeRAM();
@@ -62,21 +201,51 @@ public:
 	/* Check if memory address is in ROM and only affects Banking */
 	bool isBanking(uint16_t addr, uint8_t value);
 
-	/* Trigger Event for reads to special memory addresses */
-	uint8_t triggerEvent(uint16_t addr);
+	/* Start DMA Transfer */
+	void DMATransfer(uint8_t data);
 
-	/* Trigger Events for writes to special memory addresses */
-	void triggerEvent(uint16_t addr, uint8_t value);
+	/* Advance time for DMA and RTC, DMA bytes are copied at completion */
+	void update(uint8_t cycles);
 
-	/* Do DMA Transfer */
-	void DMATransfer(uint8_t data);
+	/* Copy the bytes transferred so far, for observers of OAM during DMA */
+	void syncDMA();
+	bool isDMAActive();
+
+	/* Save State, the ROM is copied from the cartridge again on load */
+	void saveState(StateWriter& w);
+	void loadState(StateReader& r);
+
+	/* Copy the whole state of another Memory, the cartridge is shared */
+	void copyState(const Memory& other);
+
+	/* Global checksum from the Cartridge Header, identifies states of this cartridge */
+	uint16_t getROMChecksum();
+
+	/* ROM bank mapped to 0x4000-0x7FFF and the number of banks of the cartridge */
+	uint16_t getROMBank();
+	uint16_t getROMBankCount();
+
+	/* ROM and RAM bank switches since start, not part of the state */
+	unsigned long getBankSwitches();
+
+	/* Report accesses to the flagged pages, not part of the state */
+	void setWatchpoints(Breakpoints* b, const uint8_t pages[WATCH_PAGES]);
+
+	/* Report reads of the cartridge, NULL when off */
+	void setCodeLog(CodeLog* c);
+
+	/* true, until the boot ROM is unmapped from 0x0000-0x00FF */
+	bool isBootROMMapped();
 
 	/* Methods */
 	uint8_t read_8u(uint16_t addr);
 	int8_t read_8s(uint16_t addr);
 
 	void write_8u(uint16_t addr, uint8_t value);
+
+	/* Raw access for the hardware itself, i.e. interrupt flags: no I/O handlers, DMA lockout or watchpoints */
 	void privilegedWrite8u(uint16_t addr, uint8_t value);
+	uint8_t privilegedRead8u(uint16_t addr);
 
 	uint16_t read_16u(uint16_t addr);
 	int16_t read_16s(uint16_t addr);
@@ -0,0 +1,50 @@
+#ifndef MOVIE_H
+#define MOVIE_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "Joypad.h"
+
+/* "GBMV" in little endian */
+#define MOVIE_MAGIC 0x564D4247
+#define MOVIE_VERSION 1
+
+/*
+    Joypad state of every frame, starting from a save state. Only the
+    eight Game Boy buttons are recorded, X and Y trigger host functions.
+
+    File layout: magic, 16 bit version, 32 bit frame count, 32 bit size
+    of the start state, the start state, then runs of 8 bit buttons and
+    16 bit number of frames.
+*/
+class Movie {
+private:
+	/* Attributes */
+	std::vector<uint8_t> startState;
+	std::vector<uint8_t> frames;
+	size_t position;
+	bool recording;
+
+public:
+	/* Constructor */
+	Movie(bool record);
+
+	/* Apply or record the buttons of the next frame, false at the end of a replay */
+	bool update(Joypad* joypad);
+
+	bool isRecording();
+
+	/* Continue like a replay that reached the end */
+	void stopRecording();
+	size_t getFrameCount();
+
+	void setStartState(const std::vector<uint8_t>& state);
+	const std::vector<uint8_t>& getStartState();
+
+	bool writeFile(std::string file);
+	bool readFile(std::string file);
+};
+
+#endif /* MOVIE_H */
@@ -0,0 +1,63 @@
+#ifndef PRESENTER_H
+#define PRESENTER_H
+
+#include <cstdint>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <string>
+
+#include "GUI.h"
+
+/* Set in the shared buffer index when it holds a frame not yet presented */
+#define BUFFER_FRESH 0x4
+
+/*
+    Runs the GUI on its own thread, so texture uploads and vsync never
+    stall emulation. Frames are handed over through a lock-free triple
+    buffer: the emulation thread writes to its own buffer and swaps it
+    with the shared one, the presenter swaps the shared one with the
+    buffer it reads from. Input is handed back as button and hotkey
+    bitmasks and applied on the emulation thread.
+*/
+class Presenter {
+private:
+	/* Attributes */
+	uint8_t buffers[3][HEIGHT][WIDTH];
+
+	/* Index of the shared buffer, BUFFER_FRESH set when unread */
+	std::atomic<uint8_t> shared;
+
+	/* Owned by the emulation thread */
+	uint8_t writeIndex;
+
+	/* Owned by the presenter thread */
+	uint8_t readIndex;
+
+	/* Written by the presenter thread */
+	std::atomic<uint16_t> buttons;
+	std::atomic<uint8_t> hotkeys;
+	std::atomic<bool> rewindHeld;
+
+	/* Written by the emulation thread, overlayChanged set until taken */
+	std::mutex overlayMutex;
+	std::string overlay;
+	std::atomic<bool> overlayChanged;
+
+	std::atomic<bool> running;
+	std::thread thread;
+
+	void loop();
+
+public:
+	/* Constructor and Destructor */
+	Presenter();
+	~Presenter();
+
+	/* Methods called from the emulation thread */
+	void submitFrame(uint8_t framebuffer[][WIDTH]);
+	void pollInput(Joypad* joypad);
+	void setOverlay(const std::string& text);
+};
+
+#endif /* PRESENTER_H */
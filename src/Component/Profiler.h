@@ -0,0 +1,83 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <unordered_map>
+
+/* Index of the CB opcodes in the opcode table */
+#define PROFILER_EXT_OPCODES 0x100
+
+/* Deepest tracked call stack, deeper calls are counted in the caller */
+#define PROFILER_MAX_DEPTH 256
+
+/* Hot spots listed in the report */
+#define PROFILER_REPORT_LOCATIONS 64
+
+/*
+    Counts executions and cycles per opcode and per code location, and
+    the cycles of every call path for flame graphs. A location is the
+    ROM bank in the upper 16 bits and the address in the lower ones,
+    the bank is 0 outside of 0x4000-0x7FFF. Calls are followed by the
+    stack pointer: a return removes every frame whose return address
+    it popped, so stack tricks do not corrupt the call paths.
+*/
+class Profiler {
+private:
+	struct Counter {
+		uint64_t count;
+		uint64_t cycles;
+	};
+
+	/* Call path: function is the location called, cycles spent in it without callees */
+	struct Node {
+		uint32_t parent;
+		uint32_t function;
+		uint64_t cycles;
+	};
+
+	struct Frame {
+		uint32_t node;
+		uint16_t sp;
+	};
+
+	/* Attributes */
+	Counter opcodes[2 * PROFILER_EXT_OPCODES];
+
+	/* ROM by physical offset, everything from 0x8000 by address */
+	std::vector<Counter> rom;
+	std::vector<Counter> ram;
+	uint64_t haltedCycles;
+
+	std::vector<Node> nodes;
+	std::unordered_map<uint64_t, uint32_t> children;
+	std::vector<Frame> stack;
+	uint32_t current;
+
+	Counter& getCounter(uint32_t location);
+	std::string getPath(uint32_t node);
+	static std::string getMnemonic(const char* name);
+
+public:
+	/* Constructor */
+	Profiler(uint16_t romBankCount);
+
+	static uint32_t getLocation(uint16_t bank, uint16_t pc);
+
+	/* CB opcodes add their cycles to the location of the prefix */
+	void addInstruction(uint16_t opcode, uint32_t location, uint8_t ticks);
+	void addHalted(uint8_t ticks);
+
+	/* Taken calls, interrupts and returns with the stack pointer afterwards */
+	void enter(uint32_t location, uint16_t sp);
+	void leave(uint16_t sp);
+
+	/* Opcodes and hot spots sorted by cycles */
+	bool writeReport(std::string file);
+
+	/* "caller;callee cycles" lines for flamegraph.pl and compatible tools */
+	bool writeCollapsed(std::string file);
+};
+
+#endif /* PROFILER_H */
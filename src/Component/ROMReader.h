@@ -13,21 +13,16 @@ using namespace std;
 
 class ROMReader {
 private:
-	/* Attributes */
-	static Memory* mem;
-
 	/* Private constructor to prevent initialisation */
 	ROMReader() {};
 
 public:
 	/* Methods */
-	static void setMemory(Memory* m);
-
-	static void copy(string file);
-	static void load(string file);
+	static bool copy(Memory* mem, string file);
+	static void load(Memory* mem, string file);
 	static string getRomName(string file);
-	static void dumpSavegame(string file);
-	static bool tryToLoadSavegame(string file);
+	static void dumpSavegame(Memory* mem, string file);
+	static bool tryToLoadSavegame(Memory* mem, string file);
 };
 
 #endif /* ROMREADER_H */
\ No newline at end of file
@@ -0,0 +1,72 @@
+#ifndef REWIND_H
+#define REWIND_H
+
+#include <cstdint>
+#include <cstddef>
+#include <vector>
+
+/* Frames between two keyframes */
+#define REWIND_KEYFRAME_INTERVAL 60
+
+/* Shortest run of unchanged bytes that ends a literal run */
+#define REWIND_MIN_SKIP 4
+
+/* Average bytes per snapshot the entry table is sized for */
+#define REWIND_ENTRY_RATIO 1024
+
+/*
+    History of save states for rewinding, one per frame. Every snapshot is
+    XORed against the last keyframe and run length encoded: unchanged bytes
+    are skipped, changed ones stored as literals. Keyframes are encoded the
+    same way against zero. Snapshots are written into a fixed ring, the
+    oldest are overwritten, so pushing never allocates.
+*/
+class Rewind {
+private:
+	struct Entry {
+		uint32_t offset;
+		uint32_t size;
+		bool keyframe;
+	};
+
+	/* Encoded snapshots */
+	uint8_t* ring;
+	size_t capacity;
+	size_t writeOffset;
+
+	/* Entries from oldest to newest */
+	Entry* entries;
+	size_t maxEntries;
+	size_t first;
+	size_t count;
+
+	/* Decoded newest keyframe, the base of new snapshots */
+	std::vector<uint8_t> keyState;
+	size_t stateSize;
+	unsigned int framesSinceKeyframe;
+
+	Entry& getEntry(size_t index);
+	size_t getMaxEncodedSize();
+	void dropOldest();
+	void reserve(size_t size);
+	void restoreKeyframe();
+
+	size_t encode(const uint8_t* state, const uint8_t* base, uint8_t* out);
+	void decode(const Entry& entry, uint8_t* state);
+
+public:
+	/* Constructor and Destructor */
+	Rewind(size_t budget, size_t stateSize);
+	~Rewind();
+
+	/* Append a snapshot of stateSize bytes */
+	void push(const uint8_t* state);
+
+	/* Remove the newest snapshot and decode it into state, false when empty */
+	bool pop(uint8_t* state);
+
+	size_t getFrameCount();
+	size_t getUsedBytes();
+};
+
+#endif /* REWIND_H */
@@ -0,0 +1,119 @@
+#ifndef SAVESTATE_H
+#define SAVESTATE_H
+
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+/* "GBST" in little endian */
+#define STATE_MAGIC 0x54534247
+
+/* Increment on every change of the layout written by the components */
+#define STATE_VERSION 1
+
+/*
+    Header layout:
+    0x0 Magic
+    0x4 Version
+    0x6 Global checksum of the cartridge the state belongs to
+    0x8 Payload size
+    0xC Adler-32 of the payload
+*/
+#define STATE_HEADER_SIZE 16
+
+/*
+    Appends raw fields to a caller owned buffer. The buffer is only
+    resized, so reusing it for the next state does not allocate. Without
+    a buffer the fields are only counted, for the size of a state.
+*/
+class StateWriter {
+private:
+	std::vector<uint8_t>* buffer;
+	size_t size;
+
+public:
+	StateWriter(std::vector<uint8_t>& b) : buffer(&b), size(0) {}
+	StateWriter() : buffer(NULL), size(0) {}
+
+	void write(const void* data, size_t n) {
+		size += n;
+		if (buffer == NULL) {
+			return;
+		}
+		size_t pos = buffer->size();
+		buffer->resize(pos + n);
+		memcpy(&(*buffer)[pos], data, n);
+	}
+
+	template <typename T>
+	void write(const T& value) {
+		write(&value, sizeof(T));
+	}
+
+	/* Bytes written by this writer */
+	size_t getSize() {
+		return size;
+	}
+};
+
+/* Reads fields in the order they were written, fails instead of reading past the end */
+class StateReader {
+private:
+	const uint8_t* data;
+	size_t size;
+	size_t pos;
+	bool failed;
+
+public:
+	StateReader(const uint8_t* d, size_t s) : data(d), size(s), pos(0), failed(false) {}
+
+	void read(void* out, size_t n) {
+		if (failed || n > size - pos) {
+			failed = true;
+			return;
+		}
+		memcpy(out, data + pos, n);
+		pos += n;
+	}
+
+	template <typename T>
+	void read(T& value) {
+		read(&value, sizeof(T));
+	}
+
+	/* true, when every field was read and nothing is left */
+	bool isComplete() {
+		return !failed && pos == size;
+	}
+};
+
+class SaveState {
+private:
+	/* Private constructor to prevent instantiation of this class */
+	SaveState() {}
+
+public:
+	/* Reset buffer to an empty header, the components append their state */
+	static void begin(std::vector<uint8_t>& buffer);
+
+	/* Fill in the header for the appended payload */
+	static void finish(std::vector<uint8_t>& buffer, uint16_t romChecksum);
+
+	/* Check header and payload, returns an error message or NULL */
+	static const char* verify(const std::vector<uint8_t>& buffer, uint16_t romChecksum);
+
+	static const uint8_t* getPayload(const std::vector<uint8_t>& buffer);
+	static size_t getPayloadSize(const std::vector<uint8_t>& buffer);
+
+	static uint32_t checksum(const uint8_t* data, size_t size);
+
+	/* FNV-1a, to compare states across runs */
+	static uint64_t hash(const uint8_t* data, size_t size);
+
+	/* File helpers */
+	static bool writeFile(std::string file, const std::vector<uint8_t>& buffer);
+	static bool readFile(std::string file, std::vector<uint8_t>& buffer);
+};
+
+#endif /* SAVESTATE_H */
@@ -0,0 +1,76 @@
+#ifndef SHAREDFRAME_H
+#define SHAREDFRAME_H
+
+#include <cstdint>
+#include <atomic>
+#include <string>
+
+/* "GBSF" in little endian */
+#define SHARED_FRAME_MAGIC 0x46534247
+#define SHARED_FRAME_VERSION 1
+
+/* Same size as the GPU frameBuffer, kept here so frontends only need this header */
+#define SHARED_FRAME_WIDTH 160
+#define SHARED_FRAME_HEIGHT 144
+
+class Joypad;
+
+/*
+    Layout of the shared memory segment. The emulator writes frames
+    under a seqlock: sequence is odd while a frame is written, readers
+    copy the frame and retry when sequence was odd or changed meanwhile.
+    Pixels are shades 0 (white) to 3 (black). Frontends write buttons
+    with one bit per Joypad::Button and may set quit.
+*/
+struct SharedFrameLayout {
+	uint32_t magic;
+	uint16_t version;
+	uint16_t width;
+	uint16_t height;
+
+	std::atomic<uint32_t> sequence;
+	uint64_t frame;
+	uint8_t pixels[SHARED_FRAME_HEIGHT][SHARED_FRAME_WIDTH];
+
+	/* Written by the frontend */
+	std::atomic<uint16_t> buttons;
+	std::atomic<uint8_t> quit;
+};
+
+/*
+    Publishes every rendered frame to a POSIX shared memory segment and
+    reads the joypad from it, so other processes can show or record the
+    frames and send input without copying them through a socket or pipe.
+    The emulator creates the segment, frontends attach to it.
+*/
+class SharedFrame {
+private:
+	/* Attributes */
+	SharedFrameLayout* layout;
+	std::string name;
+	bool owner;
+
+	bool map(std::string name, bool create);
+
+public:
+	/* Constructor and Destructor */
+	SharedFrame();
+	~SharedFrame();
+
+	/* Create the segment, i.e. "/gbemu", removed again by the destructor */
+	bool create(std::string name);
+
+	/* Attach to a segment created by the emulator */
+	bool attach(std::string name);
+
+	/* Emulator side */
+	void publishFrame(uint8_t framebuffer[][SHARED_FRAME_WIDTH], uint64_t frame);
+	void pollInput(Joypad* joypad);
+
+	/* Frontend side: copy the latest frame into pixels, returns its number */
+	uint64_t readFrame(uint8_t pixels[][SHARED_FRAME_WIDTH]);
+	void setButtons(uint16_t buttons);
+	void requestQuit();
+};
+
+#endif /* SHAREDFRAME_H */
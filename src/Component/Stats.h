@@ -0,0 +1,72 @@
+#ifndef STATS_H
+#define STATS_H
+
+#include <cstdint>
+#include <string>
+#include <chrono>
+
+/* Frames the percentiles and the jitter are taken over */
+#define STATS_WINDOW 600
+
+/* Frames between two reports, one emulated second */
+#define STATS_REPORT_FRAMES 60
+
+/*
+    Live performance of the emulation thread, sampled at every frame
+    boundary. Host frame time is the time spent emulating a frame,
+    without pacing. Speed, late frames, instructions and bank switches
+    are taken over the last report period, frame time percentiles and
+    jitter, the standard deviation of the time between frames, over the
+    last STATS_WINDOW frames.
+*/
+class Stats {
+private:
+	/* Attributes */
+	std::chrono::steady_clock::time_point frameStart;
+	std::chrono::steady_clock::time_point lastFrame;
+
+	/* Milliseconds per frame, ring of the last STATS_WINDOW frames */
+	double frameTimes[STATS_WINDOW];
+	double intervals[STATS_WINDOW];
+	unsigned long frames;
+
+	/* Report period */
+	unsigned int periodFrames;
+	unsigned int periodLate;
+	double periodTime;
+	unsigned long lastInstructions;
+	unsigned long lastBankSwitches;
+	unsigned long periodInstructions;
+	unsigned long periodBankSwitches;
+
+	/* Last report */
+	double speed;
+	double p50;
+	double p95;
+	double p99;
+	double jitter;
+	unsigned int lateFrames;
+	double instructionsPerFrame;
+	double bankSwitchesPerFrame;
+
+	double getPercentile(double p);
+	void report();
+
+public:
+	/* Constructor */
+	Stats();
+
+	/* At the frame boundary, with the running totals of the machine */
+	void finishFrame(unsigned long instructions, unsigned long bankSwitches);
+
+	/* After pacing the frame, true when a new report is ready */
+	bool finishPacing(bool late);
+
+	/* Two short lines for the overlay */
+	std::string getOverlay();
+
+	/* "name value" lines, replaced atomically for scrapers */
+	bool writeFile(std::string file);
+};
+
+#endif /* STATS_H */
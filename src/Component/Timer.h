@@ -19,29 +19,64 @@
 
 #include "Memory.h"
 
+/*
+    DIV and TIMA are not counted per instruction, but derived from the
+    tick counter when read. DIV and TIMA both count from the internal
+    divider, so TIMA increments stay aligned to it. The next TIMA overflow
+    is precomputed as a single deadline, so update only adds the cycles
+    and compares against it.
+*/
 class Timer {
 private:
     Memory* mem;
-    int timerCounter;
-    int dividerCounter;
-    uint8_t currentFreq;
+
+    /* Ticks since power on */
+    unsigned long ticks;
+
+    /* Ticks at the last divider reset */
+    unsigned long divBase;
+
+    /* TIMA value at timaBase ticks */
+    uint8_t timaStart;
+    unsigned long timaBase;
+
+    /* Ticks of the next TIMA overflow */
+    unsigned long overflowDeadline;
+
+    /* Shadow of TMC */
+    uint8_t control;
 
 public:
     Timer(Memory* mem);
 
     void update(uint8_t cycles);
 
+    /* Called by Memory for reads and writes to DIV, TIMA, TMA and TMC */
+    uint8_t readRegister(uint16_t addr);
+    void writeRegister(uint16_t addr, uint8_t value);
+
+    /* Set the internal divider, i.e. to the value the boot ROM leaves */
+    void setDivider(uint16_t value);
+
+    /* Save State */
+    void saveState(StateWriter& w);
+    void loadState(StateReader& r);
+    void copyState(const Timer& other);
+
 private:
     bool isClockEnabled();
     uint8_t getClockFreq();
-    void setClockFreq();
-    void checkFreqChange();
+    unsigned int getClockPeriod();
 
-    void updateDividerRegister(uint8_t cycles);
+    uint16_t getDivider();
+    uint8_t getCounter();
+    void rebaseCounter();
+    void updateDeadline();
+    void handleOverflow();
 
     void triggerInterrupt();
 };
 
 
 
-#endif /* TIMER_H */
\ No newline at end of file
+#endif /* TIMER_H */
@@ -0,0 +1,80 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <cstdint>
+#include <atomic>
+#include <mutex>
+#include <string>
+#include <vector>
+
+/* Events kept per thread, older ones are overwritten */
+#define TRACE_BUFFER_EVENTS (1 << 18)
+
+/* Time the enclosing scope under name, which has to be a string literal */
+#define TRACE_SCOPE(name) TraceScope traceScope(name)
+
+/*
+    Host time spent in the phases of emulation, to find the cause of
+    slow frames. Every thread records into its own ring of events, the
+    newest ones are exported in the Chrome trace format, which Perfetto
+    and chrome://tracing open. When tracing is off a scope costs one
+    check of a flag.
+*/
+class Trace {
+private:
+	struct Event {
+		const char* name;
+		uint64_t start;
+		uint64_t duration;
+	};
+
+	struct Buffer {
+		std::vector<Event> events;
+		size_t count;
+		unsigned int thread;
+		std::mutex mutex;
+	};
+
+	static std::atomic<bool> enabled;
+	static std::mutex mutex;
+	static std::vector<Buffer*> buffers;
+
+	static Buffer* getBuffer();
+
+	/* Private constructor to prevent instantiation of this class */
+	Trace() {}
+
+public:
+	/* Start recording in all threads */
+	static void enable();
+	static bool isEnabled() {
+		return enabled.load(std::memory_order_relaxed);
+	}
+
+	/* Nanoseconds since an arbitrary start, never 0 */
+	static uint64_t now();
+
+	/* Record a finished phase of the calling thread */
+	static void add(const char* name, uint64_t start, uint64_t end);
+
+	/* Stop recording and write the events as Chrome trace JSON */
+	static bool writeFile(std::string file);
+};
+
+/* Records the time from construction to destruction */
+class TraceScope {
+private:
+	const char* name;
+	uint64_t start;
+
+public:
+	TraceScope(const char* n) : name(n), start(Trace::isEnabled() ? Trace::now() : 0) {}
+
+	~TraceScope() {
+		if (start) {
+			Trace::add(name, start, Trace::now());
+		}
+	}
+};
+
+#endif /* TRACE_H */
@@ -0,0 +1,91 @@
+#ifndef VECENV_H
+#define VECENV_H
+
+#include <cstdint>
+#include <string>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+
+#include "Emulator.h"
+
+/* Framebuffer bytes at the start of every observation */
+#define VECENV_SCREEN_SIZE (SCREEN_HEIGHT * SCREEN_WIDTH)
+
+/*
+    Batch of independent headless machines for reinforcement learning,
+    stepped together by a pool of worker threads. All machines start
+    from the state right after the boot ROM. Actions are one byte per
+    machine with one bit per Joypad::Button. Observations are written
+    into a caller owned buffer of getObservationSize() bytes per machine:
+    the framebuffer followed by the selected RAM bytes. Stepping does
+    not allocate.
+*/
+class VecEnv {
+private:
+	/* Attributes */
+	std::vector<Emulator*> envs;
+
+	/* State every machine is reset to */
+	Emulator* initial;
+
+	std::vector<uint16_t> ramAddresses;
+
+	/* Current batch, read by the workers */
+	const uint8_t* actions;
+	uint8_t* observations;
+	unsigned int repeat;
+	bool resetting;
+
+	/* Machines are handed out one at a time, so fast workers take over the rest */
+	std::atomic<size_t> nextEnv;
+
+	/* Worker pool, the calling thread works on every batch as well */
+	std::vector<std::thread> workers;
+	std::mutex mutex;
+	std::condition_variable batchStarted;
+	std::condition_variable batchFinished;
+	unsigned long generation;
+	unsigned int busyWorkers;
+	bool stopping;
+
+	/* Statistics */
+	unsigned long steps;
+	std::chrono::steady_clock::duration stepTime;
+
+	void workerLoop();
+	void runBatch();
+	void work();
+	void stepEnv(size_t index);
+	void writeObservation(size_t index, uint8_t* out);
+
+public:
+	/* Constructor and Destructor, threads 0 uses every core */
+	VecEnv(std::string bootRom, std::string rom, size_t count, unsigned int threads = 0);
+	~VecEnv();
+
+	/* RAM bytes appended to every observation */
+	void setRAMObservation(const std::vector<uint16_t>& addresses);
+	size_t getObservationSize();
+	size_t getCount();
+	unsigned int getThreadCount();
+
+	/* Reset all machines, observations may be NULL */
+	void reset(uint8_t* observations);
+
+	/* Reset a single machine, i.e. at the end of its episode */
+	void resetEnv(size_t index, uint8_t* observation);
+
+	/* Run every machine for repeat frames with its action held, only the last frame is rendered */
+	void step(const uint8_t* actions, uint8_t* observations, unsigned int repeat = 1);
+
+	Emulator* getEnv(size_t index);
+
+	/* Throughput in machine frames per second */
+	void printStats();
+};
+
+#endif /* VECENV_H */
@@ -0,0 +1,88 @@
+#ifndef VIDEOWRITER_H
+#define VIDEOWRITER_H
+
+#include <cstdint>
+#include <cstdio>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <string>
+
+#include "GUI.h"
+
+/* Output formats */
+#define VIDEO_RAW 0		/* One byte per pixel, shades 0 (white) to 3 (black) */
+#define VIDEO_RGBA 1	/* Four bytes per pixel in the selected palette */
+#define VIDEO_Y4M 2		/* YUV4MPEG2, 4:4:4 in the selected palette */
+
+/* "FRAME\n" before every Y4M frame */
+#define Y4M_FRAME_HEADER_SIZE 6
+
+/* Frames waiting for the writer, more are dropped */
+#define VIDEO_QUEUE_SIZE 16
+
+/*
+    Streams rendered frames to a file or named pipe, i.e. into an external
+    encoder. Frames are copied into a fixed queue, the writer thread
+    converts and writes them, so emulation never waits for I/O. When the
+    queue is full the frame is dropped and counted instead. A named pipe
+    without a reader is opened by the writer thread once one connects, and
+    after the reader exits the remaining frames are dropped as well.
+*/
+class VideoWriter {
+private:
+	/* Attributes */
+	uint8_t queue[VIDEO_QUEUE_SIZE][HEIGHT][WIDTH];
+
+	/* Frames submitted and written, the difference is queued */
+	std::atomic<unsigned long> submitted;
+	std::atomic<unsigned long> written;
+	unsigned long dropped;
+
+	/* Frames taken by the writer but not written, i.e. after the reader of a pipe exited */
+	std::atomic<unsigned long> discarded;
+
+	std::string name;
+	std::string header;
+	FILE* file;
+	uint8_t format;
+	const uint32_t* palette;
+	uint8_t yuv[4][3];
+
+	/* Converted frame, owned by the writer thread */
+	uint8_t* output;
+	size_t outputSize;
+
+	std::mutex mutex;
+	std::condition_variable wake;
+	std::atomic<bool> running;
+	std::thread thread;
+
+	void loop();
+
+	/* Without blocking, NULL with errno ENXIO for a named pipe without reader */
+	FILE* openFile();
+	void convert(uint8_t framebuffer[][WIDTH]);
+
+public:
+	/* Constructor and Destructor */
+	VideoWriter();
+	~VideoWriter();
+
+	/* Open the file and start the writer, frameSkip sets the Y4M frame rate */
+	bool open(std::string file, uint8_t format, uint16_t frameSkip);
+
+	/* Write the queued frames and close the file */
+	void close();
+
+	/* Called from the emulation thread, never blocks */
+	void submitFrame(uint8_t framebuffer[][WIDTH]);
+
+	void printStats();
+
+	/* "raw", "rgba" or "y4m", 0xFF when unknown */
+	static uint8_t parseFormat(std::string name);
+};
+
+#endif /* VIDEOWRITER_H */
@@ -4,6 +4,7 @@
 #include "../Component/Output.h"
 #include "../Component/Joypad.h"
 #include "../Component/ROMReader.h"
+#include "../Component/Trace.h"
 
 #include <regex>
 #include <chrono>
@@ -14,6 +15,21 @@
 #define FLAGS_HALFCARRY (1 << 5)
 #define FLAGS_CARRY (1 << 4)
 
+/* I/O registers as left by the DMG boot ROM */
+static const uint16_t POST_BOOT_IO[][2] = {
+	{0xFF05, 0x00}, {0xFF06, 0x00}, {0xFF07, 0x00},
+	{0xFF10, 0x80}, {0xFF11, 0xBF}, {0xFF12, 0xF3}, {0xFF14, 0xBF},
+	{0xFF16, 0x3F}, {0xFF17, 0x00}, {0xFF19, 0xBF}, {0xFF1A, 0x7F},
+	{0xFF1B, 0xFF}, {0xFF1C, 0x9F}, {0xFF1E, 0xBF}, {0xFF20, 0xFF},
+	{0xFF21, 0x00}, {0xFF22, 0x00}, {0xFF23, 0xBF}, {0xFF24, 0x77},
+	{0xFF25, 0xF3}, {0xFF26, 0xF1}, {0xFF40, 0x91}, {0xFF42, 0x00},
+	{0xFF43, 0x00}, {0xFF45, 0x00}, {0xFF47, 0xFC}, {0xFF48, 0xFF},
+	{0xFF49, 0xFF}, {0xFF4A, 0x00}, {0xFF4B, 0x00}, {0xFFFF, 0x00}
+};
+
+/* Internal divider at 0x0100 after the DMG boot ROM, DIV reads 0xAB */
+#define POST_BOOT_DIVIDER 0xABCC
+
 using std::cout;
 using std::cin;
 using std::endl;
@@ -22,72 +38,281 @@ using std::regex;
 using std::sregex_iterator;
 
 /* Constructor */
-CPU::CPU(Memory* m) {
+CPU::CPU(Memory* m, bool headless) {
 	mem = m;
 	timer = new Timer(mem);
-	gpu = new GPU(mem);
+	gpu = new GPU(mem, headless);
+	joypad = new Joypad(mem);
 	interruptsEnabled = false;
 	isHalt = false;
+	bootROM = true;
 	reg.pc = 0;
 	reg.f = 0;
 	ext = 0;
 
 	globalTicks = 0;
-
-	Joypad::mem = m;
+	resetPacing();
+	rewind = NULL;
+	movie = NULL;
+	sharedFrame = NULL;
+	video = NULL;
+	frameLog = NULL;
+	profiler = NULL;
+	codeLog = NULL;
+	stats = NULL;
+	instructions = 0;
+	breakpoints = new Breakpoints(mem, &reg);
+
+	runningAhead = false;
+	aheadFrame = 0;
+	aheadRuns = 0;
+	aheadTime = std::chrono::steady_clock::duration::zero();
+	aheadBankSwitches = 0;
+
+}
+
+CPU::~CPU() {
+	delete rewind;
+	delete movie;
+	delete sharedFrame;
+	delete video;
+	delete frameLog;
+	delete profiler;
+	if (codeLog) {
+		mem->setCodeLog(NULL);
+		delete codeLog;
+	}
+	delete stats;
+	delete breakpoints;
+	delete gpu;
+	delete timer;
+	delete joypad;
 }
 
 
 /*  Util Methods */
-void CPU::run() {
+void CPU::initialize() {
 	mem->initialize();
 	readRomHeader();
 
+	// Skip the boot ROM, before the savegame is loaded into the state
+	if (!bootROM) {
+		cout << "> No boot ROM, starting from the post-boot state" << endl;
+		initializePostBoot();
+	}
+	else if (Config::isBootCacheEnabled() && loadBootCache()) {
+		cout << "> Starting from the cached post-boot state" << endl;
+	}
+
 	// Try to load savegame
 	string romName = getRomName();
-	if(ROMReader::tryToLoadSavegame(string("../ROM/" + romName + string(".sav")))) {
+	if(ROMReader::tryToLoadSavegame(mem, string("../ROM/" + romName + string(".sav")))) {
 		cout << "> Found savegame for " + romName << endl;
 	}
+}
 
-	start = std::chrono::steady_clock::now();
-	while(true) {
-		exec();
+bool CPU::run() {
+	initialize();
+
+	// Breakpoints from the command line
+	for (size_t i = 0; i < Config::getBreakpoints().size(); i++) {
+		if (breakpoints->add(Config::getBreakpoints()[i]) < 0) {
+			cout << "> Cannot parse breakpoint '" + Config::getBreakpoints()[i] + "'" << endl;
+			return false;
+		}
+	}
+
+	// Record or replay input from the current state
+	if (Config::getMovieMode() != MOVIE_OFF && !startMovie()) {
+		return false;
+	}
+
+	// Publish frames and take input through shared memory
+	if (!Config::getSharedFrame().empty()) {
+		sharedFrame = new SharedFrame();
+		if (!sharedFrame->create(Config::getSharedFrame())) {
+			cout << "> Cannot create shared memory '" + Config::getSharedFrame() + "'" << endl;
+			return false;
+		}
+		gpu->setSharedFrame(sharedFrame);
+		cout << "> Sharing frames and input through '" + Config::getSharedFrame() + "'" << endl;
+	}
+
+	// Stream rendered frames from a writer thread
+	if (!Config::getVideoFile().empty()) {
+		video = new VideoWriter();
+		if (!video->open(Config::getVideoFile(), Config::getVideoFormat(), Config::getFrameSkip())) {
+			cout << "> Cannot open '" + Config::getVideoFile() + "' for video" << endl;
+			return false;
+		}
+		gpu->setVideoWriter(video);
+		cout << "> Writing video to '" + Config::getVideoFile() + "'" << endl;
+	}
+
+	// Write or verify the hash of every rendered frame
+	if (Config::getFrameLogMode() != FRAMELOG_OFF) {
+		frameLog = new FrameLog();
+		if (!frameLog->open(Config::getFrameLogFile(), Config::getFrameLogMode())) {
+			cout << "> Cannot use frame log '" + Config::getFrameLogFile() + "'" << endl;
+			return false;
+		}
+		gpu->setFrameLog(frameLog);
+	}
+
+	// Size the rewind history by one snapshot
+	if (Config::getRewindBudget() > 0) {
+		StateWriter w(rewindBuffer);
+		saveState(w);
+		rewind = new Rewind(Config::getRewindBudget(), rewindBuffer.size());
+	}
+
+	// Report speed and frame times
+	if (Config::isOverlayEnabled() || !Config::getStatsFile().empty()) {
+		stats = new Stats();
+	}
+
+	// Profile the guest code, a separate loop so the normal one stays untouched
+	if (!Config::getProfileFile().empty()) {
+		profiler = new Profiler(mem->getROMBankCount());
+	}
+
+	// Mark executed and read cartridge bytes, merged with the log of earlier runs
+	if (!Config::getCodeLogFile().empty()) {
+		codeLog = new CodeLog(mem);
+		if (!codeLog->load(Config::getCodeLogFile())) {
+			cout << "> Code log '" + Config::getCodeLogFile() + "' belongs to another cartridge" << endl;
+			return false;
+		}
+		mem->setCodeLog(codeLog);
+	}
+
+	resetPacing();
+	if (profiler || codeLog) {
+		loop<true>();
+	} else {
+		loop<false>();
+	}
+
+	gpu->printFrameStats();
+	printRunAheadStats();
+	finishMovie();
+
+	if (video) {
+		video->close();
+		video->printStats();
+	}
+
+	bool passed = true;
+	if (frameLog) {
+		passed = frameLog->finish();
+	}
+	if (profiler) {
+		writeProfile();
+	}
+	if (codeLog) {
+		writeCodeLog();
+	}
+	if (Trace::isEnabled()) {
+		if (Trace::writeFile(Config::getTraceFile())) {
+			cout << "> Stored trace in '" + Config::getTraceFile() + "'" << endl;
+		} else {
+			cout << "> Cannot write trace '" + Config::getTraceFile() + "'" << endl;
+		}
+	}
+
+	return passed;
+}
+
+template <bool instrumented>
+void CPU::loop() {
+	while(!Config::isQuitRequested()) {
+		execute<instrumented>();
 
 		// Dump savegame
-		if(Joypad::buttons[static_cast<int>(Joypad::Button::Y)]) {
+		if(joypad->buttons[static_cast<int>(Joypad::Button::Y)]) {
 			string romName = getRomName();
-			ROMReader::dumpSavegame(string("../ROM/" + romName + string(".sav")));
+			ROMReader::dumpSavegame(mem, string("../ROM/" + romName + string(".sav")));
 			cout << "> Stored current RAM to '" + romName + ".sav'" << endl;
 
-			while(Joypad::buttons[static_cast<int>(Joypad::Button::Y)]) {
+			while(joypad->buttons[static_cast<int>(Joypad::Button::Y)] && !Config::isQuitRequested()) {
 				gpu->handleEvents();
 			}
 		}		
+
+		// Save or load state from the hotkeys
+		uint8_t stateRequest = Config::takeStateRequest();
+		if (stateRequest) {
+			handleStateRequest(stateRequest);
+		}
+
+		// Run ahead after each frame, when the input was just polled
+		uint8_t aheadFrames = Config::getRunAhead();
+		if (aheadFrames && gpu->getFrameCount() != aheadFrame) {
+			runAhead(aheadFrames);
+		}
 	}
 }
 
 void CPU::exec() {
+	// The frame after a recording is instrumented like the main loop, frames run ahead only for the code log
+	if (profiler || codeLog) {
+		execute<true>();
+	} else {
+		execute<false>();
+	}
+}
+
+template <bool instrumented>
+void CPU::execute() {
 	if (isHalt) {
 		debug();
 		if (isAnyInterruptTriggered()) {
 			isHalt = false;
 		}
 		timer->update(4);
+		mem->update(4);
 		gpu->update(4);
 
+		if (instrumented && profiler) {
+			profiler->addHalted(4);
+		}
+
 		globalTicks += 4;
 		wait();
 
 		return;
 	}
 
+	uint16_t sp = reg.sp;
 	if (!ext) {
 		manageMemory();
 		handleInterrupts();	
+
+		// Dispatching an interrupt calls its vector
+		if (instrumented && profiler && reg.sp != sp) {
+			profiler->enter(getProfileLocation(reg.pc), reg.sp);
+			sp = reg.sp;
+		}
 	}
 	
+	// Stop in the debugger, the bitmap is only tested while breakpoints are set
+	if (breakpoints->isArmed() && !ext && breakpoints->isHit(reg.pc)) {
+		Config::enableDebug();
+	}
+
+	if (instrumented && codeLog) {
+		logInstruction();
+	}
+
 	uint8_t opcode = mem->read_8u(reg.pc);
 	dumpInstr(opcode);
+	instructions++;
+
+	bool extended = ext == 1;
+	uint32_t location = 0;
+	if (instrumented && profiler) {
+		location = getProfileLocation(extended ? reg.pc - 1 : reg.pc);
+	}
 
 	uint8_t ticks;
 	if(ext == 1) {
@@ -103,15 +328,66 @@ void CPU::exec() {
 		ticks = ticks + instruction[opcode].ticks;
 		reg.pc += instruction[opcode].length;
 	}
+
+	if (instrumented && profiler) {
+		profileInstruction(extended ? PROFILER_EXT_OPCODES + opcode : opcode, location, sp, ticks);
+	}
+
 	timer->update(ticks);
+	mem->update(ticks);
 	gpu->update(ticks);
 
 	globalTicks += ticks;
 	wait();
 }
 
+uint32_t CPU::getProfileLocation(uint16_t pc) {
+	return Profiler::getLocation(mem->getROMBank(), pc);
+}
+
+void CPU::profileInstruction(uint16_t opcode, uint32_t location, uint16_t sp, uint8_t ticks) {
+	profiler->addInstruction(opcode, location, ticks);
+
+	// CALL, conditional CALL and RST push the return address when taken
+	bool call = opcode == 0xCD || (opcode & 0xE7) == 0xC4 || (opcode & 0xC7) == 0xC7;
+	if (call && reg.sp == (uint16_t) (sp - 2)) {
+		profiler->enter(getProfileLocation(reg.pc), reg.sp);
+	}
+
+	// RET, RETI and conditional RET
+	bool ret = opcode == 0xC9 || opcode == 0xD9 || (opcode & 0xE7) == 0xC0;
+	if (ret && reg.sp == (uint16_t) (sp + 2)) {
+		profiler->leave(reg.sp);
+	}
+}
+
+void CPU::writeProfile() {
+	string file = Config::getProfileFile();
+	if (profiler->writeReport(file) && profiler->writeCollapsed(file + ".folded")) {
+		cout << "> Stored profile in '" + file + "' and '" + file + ".folded'" << endl;
+	} else {
+		cout << "> Cannot write profile '" + file + "'" << endl;
+	}
+}
+
+void CPU::logInstruction() {
+	// Before the opcode is fetched, so neither it nor the operands count as data
+	uint8_t opcode = mem->privilegedRead8u(reg.pc);
+	uint8_t length = ext || opcode == 0xCB ? 1 : instruction[opcode].size;
+	codeLog->addInstruction(reg.pc, length > 0 ? length : 1, ext == 1);
+}
+
+void CPU::writeCodeLog() {
+	string file = Config::getCodeLogFile();
+	if (codeLog->writeFile(file)) {
+		cout << "> Stored code log in '" + file + "'" << endl;
+	} else {
+		cout << "> Cannot write code log '" + file + "'" << endl;
+	}
+	codeLog->printStats();
+}
+
 void CPU::disassemble() {
-	mem->initialize();
 	uint8_t opcode = mem->read_8u(reg.pc);
 	dumpInstr(opcode);
 	if(ext == 1) {
@@ -125,13 +401,367 @@ void CPU::disassemble() {
 	}
 }
 
+/* Pace emulation to real time once per emulated frame */
 void CPU::wait() {
+	if (globalTicks < paceTicks || runningAhead) {
+		return;
+	}
+	paceTicks += TICKS_PER_FRAME;
+
+	// One slice per emulated frame, pacing is traced separately
+	if (Trace::isEnabled()) {
+		Trace::add("CPU::exec", traceStart, Trace::now());
+	}
+	if (stats) {
+		stats->finishFrame(instructions, mem->getBankSwitches() - aheadBankSwitches);
+	}
+
+	bool late = pace();
+
+	if (stats && stats->finishPacing(late)) {
+		publishStats();
+	}
+	if (Trace::isEnabled()) {
+		traceStart = Trace::now();
+	}
+}
+
+bool CPU::pace() {
+	TRACE_SCOPE("CPU::wait");
+
+	if (rewind && updateRewind()) {
+		return false;
+	}
+
+	// Speed 0 runs unlimited
+	double speed = Config::getSpeed();
+	if (speed <= 0) {
+		return false;
+	}
+	if (speed != paceSpeed) {
+		resetPacing();
+		return false;
+	}
+
+	double ns = (paceTicks - startTicks) * (1e9 / CLOCK_RATE) / speed;
+	std::chrono::steady_clock::time_point deadline = start + std::chrono::nanoseconds((long long) ns);
 	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
-	std::chrono::nanoseconds t = std::chrono::duration_cast<std::chrono::nanoseconds>(now - start);
 
-	while(t < std::chrono::nanoseconds(globalTicks * 238)) {  // Orginal time would be 238
-		now = std::chrono::steady_clock::now();
-		t = std::chrono::duration_cast<std::chrono::nanoseconds>(now - start);
+	// Do not try to catch up after stalls like debugging or host load
+	if (now - deadline > std::chrono::nanoseconds(PACING_MAX_LAG_NS)) {
+		resetPacing();
+		return true;
+	}
+
+	// Sleep most of the remaining time, then spin for precision
+	if (deadline - now > std::chrono::nanoseconds(PACING_SPIN_NS)) {
+		std::this_thread::sleep_until(deadline - std::chrono::nanoseconds(PACING_SPIN_NS));
+	}
+	while(std::chrono::steady_clock::now() < deadline) {
+	}
+	return now > deadline;
+}
+
+void CPU::publishStats() {
+	if (Config::isOverlayEnabled()) {
+		gpu->setOverlay(stats->getOverlay());
+	}
+	if (!Config::getStatsFile().empty()) {
+		stats->writeFile(Config::getStatsFile());
+	}
+}
+
+void CPU::runFrame() {
+	// Stop after two frame times, in case the LCD is off
+	unsigned long frame = gpu->getFrameCount();
+	unsigned long limit = globalTicks + 2 * TICKS_PER_FRAME;
+	while (gpu->getFrameCount() == frame && globalTicks < limit) {
+		exec();
+	}
+}
+
+GPU* CPU::getGPU() {
+	return gpu;
+}
+
+Joypad* CPU::getJoypad() {
+	return joypad;
+}
+
+void CPU::resetPacing() {
+	start = std::chrono::steady_clock::now();
+	traceStart = Trace::now();
+	startTicks = globalTicks;
+	paceTicks = globalTicks + TICKS_PER_FRAME;
+	paceSpeed = Config::getSpeed();
+}
+
+/* Save State Methods */
+void CPU::saveState(StateWriter& w) {
+	w.write(reg);
+	w.write(ext);
+	w.write(interruptsEnabled);
+	w.write(isHalt);
+	w.write(globalTicks);
+	w.write(joypad->buttons, sizeof(joypad->buttons));
+
+	mem->saveState(w);
+	timer->saveState(w);
+	gpu->saveState(w);
+}
+
+void CPU::loadState(StateReader& r) {
+	r.read(reg);
+	r.read(ext);
+	r.read(interruptsEnabled);
+	r.read(isHalt);
+	r.read(globalTicks);
+	r.read(joypad->buttons, sizeof(joypad->buttons));
+
+	mem->loadState(r);
+	timer->loadState(r);
+	gpu->loadState(r);
+}
+
+void CPU::saveState(std::vector<uint8_t>& buffer) {
+	SaveState::begin(buffer);
+	StateWriter w(buffer);
+	saveState(w);
+	SaveState::finish(buffer, mem->getROMChecksum());
+}
+
+bool CPU::loadState(const std::vector<uint8_t>& buffer) {
+	const char* error = SaveState::verify(buffer, mem->getROMChecksum());
+	if (error) {
+		cout << "> Cannot load state: " << error << endl;
+		return false;
+	}
+
+	// Checked before any component is touched, a partial state would leave a broken machine
+	if (SaveState::getPayloadSize(buffer) != getStateSize()) {
+		cout << "> Cannot load state: unexpected size" << endl;
+		return false;
+	}
+
+	StateReader r(SaveState::getPayload(buffer), SaveState::getPayloadSize(buffer));
+	loadState(r);
+	resetPacing();
+	return r.isComplete();
+}
+
+size_t CPU::getStateSize() {
+	// Counts the fields without copying the machine
+	StateWriter w;
+	saveState(w);
+	return w.getSize();
+}
+
+bool CPU::updateRewind() {
+	TRACE_SCOPE("CPU::updateRewind");
+
+	if (!Config::isRewinding()) {
+		rewindBuffer.clear();
+		StateWriter w(rewindBuffer);
+		saveState(w);
+		rewind->push(&rewindBuffer[0]);
+		return false;
+	}
+
+	// Step back one frame per frame time while the key is held
+	bool loaded = false;
+	while (Config::isRewinding() && !Config::isQuitRequested()) {
+		if (rewind->pop(&rewindBuffer[0])) {
+			StateReader r(&rewindBuffer[0], rewindBuffer.size());
+			loadState(r);
+			resetPacing();
+			gpu->presentFrame();
+			loaded = true;
+		} else {
+			gpu->handleEvents();
+		}
+		std::this_thread::sleep_for(std::chrono::nanoseconds((long long) (TICKS_PER_FRAME * (1e9 / CLOCK_RATE))));
+	}
+
+	return loaded;
+}
+
+void CPU::runAhead(uint8_t frames) {
+	TRACE_SCOPE("CPU::runAhead");
+
+	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+	aheadBuffer.clear();
+	StateWriter w(aheadBuffer);
+	saveState(w);
+
+	// Only the last frame ahead is rendered and shown. Stop after at most
+	// one more frame time, in case the LCD is off.
+	unsigned long frame = gpu->getFrameCount();
+	unsigned long limit = globalTicks + (frames + 1) * TICKS_PER_FRAME;
+	unsigned long realInstructions = instructions;
+	unsigned long realBankSwitches = mem->getBankSwitches();
+	runningAhead = true;
+	gpu->setSpeculative(true);
+
+	// Frames run ahead are rolled back, the call stack of the profiler is not
+	Profiler* realProfiler = profiler;
+	profiler = NULL;
+
+	gpu->setRendering(false);
+	while (gpu->getFrameCount() < frame + frames - 1 && globalTicks < limit) {
+		exec();
+	}
+	gpu->setRendering(true);
+	while (gpu->getFrameCount() < frame + frames && globalTicks < limit) {
+		exec();
+	}
+
+	runningAhead = false;
+	gpu->setSpeculative(false);
+	profiler = realProfiler;
+	StateReader r(&aheadBuffer[0], aheadBuffer.size());
+	loadState(r);
+
+	// Only the real frames count for the statistics, restoring the bank is a switch as well
+	instructions = realInstructions;
+	aheadBankSwitches += mem->getBankSwitches() - realBankSwitches;
+
+	// The real frames are never shown
+	gpu->setRendering(false);
+	aheadFrame = frame;
+
+	aheadRuns++;
+	aheadTime += std::chrono::steady_clock::now() - begin;
+}
+
+void CPU::printRunAheadStats() {
+	if (aheadRuns == 0) {
+		return;
+	}
+	double us = std::chrono::duration<double, std::micro>(aheadTime).count() / aheadRuns;
+	printf("== Run-ahead of %d frames: %.1f us per frame\n", Config::getRunAhead(), us);
+}
+
+void CPU::copyState(const CPU& other) {
+	reg = other.reg;
+	ext = other.ext;
+	interruptsEnabled = other.interruptsEnabled;
+	isHalt = other.isHalt;
+	globalTicks = other.globalTicks;
+
+	timer->copyState(*other.timer);
+	gpu->copyState(*other.gpu);
+	memcpy(joypad->buttons, other.joypad->buttons, sizeof(joypad->buttons));
+
+	resetPacing();
+}
+
+void CPU::setBootROM(bool present) {
+	bootROM = present;
+}
+
+void CPU::initializePostBoot() {
+	reg.af = 0x01B0;
+	reg.bc = 0x0013;
+	reg.de = 0x00D8;
+	reg.hl = 0x014D;
+	reg.sp = 0xFFFE;
+	reg.pc = 0x0100;
+
+	for (unsigned int i = 0; i < sizeof(POST_BOOT_IO) / sizeof(POST_BOOT_IO[0]); i++) {
+		mem->write_8u(POST_BOOT_IO[i][0], POST_BOOT_IO[i][1]);
+	}
+
+	// Writes keep only the power bit of NR52, channel 1 is still on from the boot sound
+	mem->privilegedWrite8u(0xFF26, 0xF1);
+
+	// DIV has no write other than a reset
+	timer->setDivider(POST_BOOT_DIVIDER);
+
+	// Unmap the boot ROM
+	mem->write_8u(0xFF50, 1);
+	mem->remapUnit();
+}
+
+string CPU::getBootCacheFile() {
+	// Keyed by header and global checksum of the cartridge
+	char key[16];
+	snprintf(key, sizeof(key), "%02X%04X", mem->read_8u(0x14D), mem->getROMChecksum());
+	return "../ROM/boot_" + string(key) + ".state";
+}
+
+bool CPU::loadBootCache() {
+	return SaveState::readFile(getBootCacheFile(), stateBuffer) && loadState(stateBuffer);
+}
+
+void CPU::storeBootCache() {
+	saveState(stateBuffer);
+	if (SaveState::writeFile(getBootCacheFile(), stateBuffer)) {
+		cout << "> Stored post-boot state to '" + getBootCacheFile() + "'" << endl;
+	}
+}
+
+bool CPU::startMovie() {
+	string file = Config::getMovieFile();
+	movie = new Movie(Config::getMovieMode() == MOVIE_RECORD);
+
+	if (movie->isRecording()) {
+		saveState(stateBuffer);
+		movie->setStartState(stateBuffer);
+		cout << "> Recording input to '" + file + "'" << endl;
+	}
+	else if (movie->readFile(file) && loadState(movie->getStartState())) {
+		cout << "> Replaying " << movie->getFrameCount() << " frames from '" + file + "'" << endl;
+	}
+	else {
+		cout << "> Cannot replay '" + file + "'" << endl;
+		return false;
+	}
+
+	gpu->setMovie(movie);
+	movieStart = std::chrono::steady_clock::now();
+	return true;
+}
+
+void CPU::finishMovie() {
+	if (!movie) {
+		return;
+	}
+
+	// Stop at the next frame without input, where a replay of the movie stops
+	if (movie->isRecording()) {
+		movie->stopRecording();
+		runFrame();
+
+		if (!movie->writeFile(Config::getMovieFile())) {
+			cout << "> Cannot write '" + Config::getMovieFile() + "'" << endl;
+		}
+	}
+
+	double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - movieStart).count();
+	printf("== Movie: %zu frames in %.2f s (%.0f fps)\n", movie->getFrameCount(), seconds, movie->getFrameCount() / seconds);
+
+	rewindBuffer.clear();
+	StateWriter w(rewindBuffer);
+	saveState(w);
+	printf("== Final state hash: %016llx\n", (unsigned long long) SaveState::hash(&rewindBuffer[0], rewindBuffer.size()));
+}
+
+void CPU::handleStateRequest(uint8_t request) {
+	TRACE_SCOPE("CPU::handleStateRequest");
+
+	string file = "../ROM/" + getRomName() + ".state";
+
+	if (request & STATE_REQUEST_SAVE) {
+		saveState(stateBuffer);
+		if (SaveState::writeFile(file, stateBuffer)) {
+			cout << "> Stored state to '" + file + "'" << endl;
+		}
+	}
+	if (request & STATE_REQUEST_LOAD) {
+		if (SaveState::readFile(file, stateBuffer) && loadState(stateBuffer)) {
+			cout << "> Loaded state from '" + file + "'" << endl;
+		}
 	}
 }
 
@@ -148,27 +778,27 @@ void CPU::disableInterrupts() {
 
 /* Enable Request Interrupts */
 void CPU::enableRequestInterrupt(uint8_t type) {
-	uint8_t current = mem->read_8u(INTERRUPT_ENABLE_REGISTER);
-	mem->write_8u(INTERRUPT_ENABLE_REGISTER, (current | type));
+	uint8_t current = mem->privilegedRead8u(INTERRUPT_ENABLE_REGISTER);
+	mem->privilegedWrite8u(INTERRUPT_ENABLE_REGISTER, (current | type));
 	printf("current | type: 0x%02X\n", (current | type));
 }
 
 /* Disable Request Interrupts */
 void CPU::disableRequestInterrupt(uint8_t type) {
-	uint8_t current = mem->read_8u(INTERRUPT_ENABLE_REGISTER);
-	mem->write_8u(INTERRUPT_ENABLE_REGISTER, (current & ~type));
+	uint8_t current = mem->privilegedRead8u(INTERRUPT_ENABLE_REGISTER);
+	mem->privilegedWrite8u(INTERRUPT_ENABLE_REGISTER, (current & ~type));
 }
 
 /* Trigger Request Interrupts */
 void CPU::triggerRequestInterrupt(uint8_t type) {
-	uint8_t current = mem->read_8u(INTERRUPT_REQUEST_REGISTER);
-	mem->write_8u(INTERRUPT_REQUEST_REGISTER, (current | type));
+	uint8_t current = mem->privilegedRead8u(INTERRUPT_REQUEST_REGISTER);
+	mem->privilegedWrite8u(INTERRUPT_REQUEST_REGISTER, (current | type));
 }
 
 /* Reset Request Interrupts */
 void CPU::resetRequestInterrupt(uint8_t type) {
-	uint8_t current = mem->read_8u(INTERRUPT_REQUEST_REGISTER);
-	mem->write_8u(INTERRUPT_REQUEST_REGISTER, (current & ~type));
+	uint8_t current = mem->privilegedRead8u(INTERRUPT_REQUEST_REGISTER);
+	mem->privilegedWrite8u(INTERRUPT_REQUEST_REGISTER, (current & ~type));
 }
 
 bool CPU::isGlobalInterrupt() {
@@ -180,12 +810,12 @@ bool CPU::isRequestInterrupt(uint8_t type) {
 }
 
 bool CPU::isRequestInterruptEnabled(uint8_t type) { 
-	uint8_t current = mem->read_8u(INTERRUPT_ENABLE_REGISTER);
+	uint8_t current = mem->privilegedRead8u(INTERRUPT_ENABLE_REGISTER);
 	return (current & type);
 }
 
 bool CPU::isRequestInterruptTriggered(uint8_t type) {
-	uint8_t current = mem->read_8u(INTERRUPT_REQUEST_REGISTER);
+	uint8_t current = mem->privilegedRead8u(INTERRUPT_REQUEST_REGISTER);
 	return (current & type);
 }
 
@@ -238,7 +868,9 @@ void CPU::handleInterrupts() {
 }
 
 void CPU::manageMemory() {
-	mem->remapUnit();
+	if (mem->remapUnit() && Config::isBootCacheEnabled()) {
+		storeBootCache();
+	}
 }
 
 /* Register Methods */
@@ -296,7 +928,7 @@ bool CPU::isCarryFlag() {
 
 /* Debug Methods */
 void CPU::debug() {
-	if(Config::isDebug() && !Config::isWaiting(reg.pc)) {
+	if(Config::isDebug()) {
 		string input;
 		for(;;) {
 			getline(cin, input);
@@ -404,7 +1036,11 @@ void CPU::debug() {
 				sregex_iterator it(input.begin(), input.end(), re);
 				uint16_t w = strtoul(it->str().c_str(), NULL, 16);
 
-				Config::waitForPC(w, false);
+				// Run until pc >= w
+				char spec[16];
+				snprintf(spec, sizeof(spec), "%04X-FFFF", w);
+				breakpoints->add(spec, BREAK_EXECUTE, true);
+				Config::disableDebug();
 				return;
 			}
 			if (input.substr(0,2).compare("gg") == 0) {
@@ -413,9 +1049,44 @@ void CPU::debug() {
 				sregex_iterator it(input.begin(), input.end(), re);
 				uint16_t w = strtoul(it->str().c_str(), NULL, 16);
 
-				Config::waitForPC(w, true);
+				// Run until pc == w
+				char spec[16];
+				snprintf(spec, sizeof(spec), "%04X", w);
+				breakpoints->add(spec, BREAK_EXECUTE, true);
+				Config::disableDebug();
 				return;
 			}
+			if (input.substr(0,2).compare("b ") == 0) {
+				printf("\33[2K\033[A\33[2K");
+				addBreakpoint(input.substr(2), BREAK_EXECUTE);
+			}
+			if (input.substr(0,2).compare("wr") == 0) {
+				printf("\33[2K\033[A\33[2K");
+				addBreakpoint(input.substr(2), BREAK_READ);
+			}
+			if (input.substr(0,2).compare("ww") == 0) {
+				printf("\33[2K\033[A\33[2K");
+				addBreakpoint(input.substr(2), BREAK_WRITE);
+			}
+			if (input.substr(0,2).compare("wa") == 0) {
+				printf("\33[2K\033[A\33[2K");
+				addBreakpoint(input.substr(2), BREAK_READ | BREAK_WRITE);
+			}
+			if (input.substr(0,2).compare("bl") == 0) {
+				printf("\33[2K\033[A\33[2K");
+				breakpoints->list();
+			}
+			if (input.substr(0,2).compare("bd") == 0) {
+				printf("\33[2K\033[A\33[2K");
+				int id = atoi(input.substr(2).c_str());
+				if (!breakpoints->remove(id)) {
+					printf(RED "No breakpoint %d. Please enter bd {id} as listed by bl\n" DEFAULT, id);
+				}
+			}
+			if (input.substr(0,2).compare("bc") == 0) {
+				printf("\33[2K\033[A\33[2K");
+				breakpoints->clear();
+			}
 			if (input.substr(0,4).compare("exit") == 0) {
 				exit(0);
 			}
@@ -424,7 +1095,7 @@ void CPU::debug() {
 }
 
 void CPU::dumpInstr(uint16_t opcode) {
-	if (!(Config::isDebug() && !Config::isWaiting(reg.pc))) {
+	if (!Config::isDebug()) {
 		return;
 	}
 
@@ -553,6 +1224,16 @@ void CPU::stackdump() {
 	printf(GRAY "\n-------------------------------------------------\n\n" DEFAULT);
 }
 
+void CPU::addBreakpoint(string spec, uint8_t access) {
+	int id = breakpoints->add(spec, access);
+	if (id < 0) {
+		printf(RED "Unknown format. Please enter {[bank:]start[-end]} [if {reg|(addr)} {op} {value}]\n" DEFAULT);
+	}
+	else {
+		printf(YELLOW "Added %d\n" DEFAULT, id);
+	}
+}
+
 void CPU::readRomHeader() {
 	string type;
 	uint8_t value = mem->read_8s(0x147);
@@ -850,7 +1531,8 @@ uint8_t CPU::rrca() {
 
 uint8_t CPU::stop() {
 	printf("STOP at 0x%04x\n", reg.pc);
-	while(!Joypad::isAnyButtonPressed()) {
+	// Without a window no button can be pressed to wake up
+	while(!joypad->isAnyButtonPressed() && !Config::isQuitRequested() && !gpu->isHeadless()) {
 		gpu->handleEvents();
 	}
 	return 0;
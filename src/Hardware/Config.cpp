@@ -2,15 +2,36 @@
 
 bool Config::debug = false;
 
-bool Config::waiting = false;
-bool Config::equals = false;
-uint16_t Config::waitPc = 0;
+std::vector<std::string> Config::breakpoints;
 
 
 bool Config::moveToEnabled = false;
 uint16_t Config::moveToCounter = 0;
 uint16_t Config::counter = 0;
 
+uint16_t Config::frameSkip = 1;
+uint8_t Config::colorPalette = 0;
+double Config::speed = 1.0;
+
+std::atomic<bool> Config::quit(false);
+uint8_t Config::stateRequest = 0;
+size_t Config::rewindBudget = 0;
+bool Config::rewinding = false;
+uint8_t Config::runAhead = 0;
+bool Config::bootCache = false;
+std::string Config::movieFile;
+uint8_t Config::movieMode = MOVIE_OFF;
+std::string Config::sharedFrame;
+std::string Config::videoFile;
+uint8_t Config::videoFormat = 0;
+std::string Config::frameLogFile;
+uint8_t Config::frameLogMode = FRAMELOG_OFF;
+std::string Config::profileFile;
+std::string Config::traceFile;
+std::string Config::codeLogFile;
+bool Config::overlay = false;
+std::string Config::statsFile;
+
 void Config::enableDebug() {
     debug = true;
 }
@@ -23,39 +44,12 @@ bool Config::isDebug() {
     return debug;
 }
 
-void Config::disableWaiting() {
-    waiting = false;
-}
-
-void Config::waitForPC(uint16_t pc, bool eq) {
-    waiting = true;
-    waitPc = pc;
-    equals = eq;
-}
-
-bool Config::isWaiting(uint16_t pc) {
-    if (waiting) {
-        if (equals) {
-            if (waitPc != pc) {
-                return true;
-            } else {
-                waiting = false;
-                equals = false;
-                waitPc = 0;
-                return false;
-            }
-        } else {
-            if (waitPc > pc ) {
-                return true;
-            } else {
-                waiting = false;
-                equals = false;
-                waitPc = 0;
-                return false;
-            }
-        }
-    }
-    return false;
+void Config::addBreakpoint(std::string spec) {
+    breakpoints.push_back(spec);
+}
+
+const std::vector<std::string>& Config::getBreakpoints() {
+    return breakpoints;
 }
 
 void Config::enableCounter(uint16_t c) {
@@ -79,3 +73,164 @@ bool Config::isCounting() {
         return false;
     }
 }
+
+void Config::setFrameSkip(uint16_t n) {
+    frameSkip = n;
+}
+
+uint16_t Config::getFrameSkip() {
+    return frameSkip;
+}
+
+void Config::setSpeed(double s) {
+    speed = s;
+}
+
+double Config::getSpeed() {
+    return speed;
+}
+
+void Config::setColorPalette(uint8_t p) {
+    colorPalette = p;
+}
+
+uint8_t Config::getColorPalette() {
+    return colorPalette;
+}
+
+void Config::requestQuit() {
+    quit = true;
+}
+
+bool Config::isQuitRequested() {
+    return quit;
+}
+
+void Config::requestState(uint8_t request) {
+    stateRequest |= request;
+}
+
+uint8_t Config::takeStateRequest() {
+    uint8_t request = stateRequest;
+    stateRequest = 0;
+    return request;
+}
+
+void Config::setRewindBudget(size_t bytes) {
+    rewindBudget = bytes;
+}
+
+size_t Config::getRewindBudget() {
+    return rewindBudget;
+}
+
+void Config::setRewinding(bool r) {
+    rewinding = r;
+}
+
+bool Config::isRewinding() {
+    return rewinding;
+}
+
+void Config::setRunAhead(uint8_t frames) {
+    runAhead = frames;
+}
+
+uint8_t Config::getRunAhead() {
+    return runAhead;
+}
+
+void Config::enableBootCache() {
+    bootCache = true;
+}
+
+bool Config::isBootCacheEnabled() {
+    return bootCache;
+}
+
+void Config::setMovie(std::string file, uint8_t mode) {
+    movieFile = file;
+    movieMode = mode;
+}
+
+std::string Config::getMovieFile() {
+    return movieFile;
+}
+
+uint8_t Config::getMovieMode() {
+    return movieMode;
+}
+
+void Config::setSharedFrame(std::string name) {
+    sharedFrame = name;
+}
+
+std::string Config::getSharedFrame() {
+    return sharedFrame;
+}
+
+void Config::setVideo(std::string file, uint8_t format) {
+    videoFile = file;
+    videoFormat = format;
+}
+
+std::string Config::getVideoFile() {
+    return videoFile;
+}
+
+uint8_t Config::getVideoFormat() {
+    return videoFormat;
+}
+
+void Config::setFrameLog(std::string file, uint8_t mode) {
+    frameLogFile = file;
+    frameLogMode = mode;
+}
+
+std::string Config::getFrameLogFile() {
+    return frameLogFile;
+}
+
+uint8_t Config::getFrameLogMode() {
+    return frameLogMode;
+}
+
+void Config::setProfileFile(std::string file) {
+    profileFile = file;
+}
+
+std::string Config::getProfileFile() {
+    return profileFile;
+}
+
+void Config::setTraceFile(std::string file) {
+    traceFile = file;
+}
+
+std::string Config::getTraceFile() {
+    return traceFile;
+}
+
+void Config::setCodeLogFile(std::string file) {
+    codeLogFile = file;
+}
+
+std::string Config::getCodeLogFile() {
+    return codeLogFile;
+}
+
+void Config::enableOverlay() {
+    overlay = true;
+}
+
+bool Config::isOverlayEnabled() {
+    return overlay;
+}
+
+void Config::setStatsFile(std::string file) {
+    statsFile = file;
+}
+
+std::string Config::getStatsFile() {
+    return statsFile;
+}
@@ -0,0 +1,63 @@
+#include "../Component/Emulator.h"
+#include "../Component/ROMReader.h"
+
+
+/* Constructor */
+Emulator::Emulator(bool headless) {
+	mem = new Memory();
+	cpu = new CPU(mem, headless);
+}
+
+Emulator::~Emulator() {
+	delete cpu;
+	delete mem;
+}
+
+/* Methods */
+void Emulator::load(std::string bootRom, std::string rom) {
+	ROMReader::load(mem, rom);
+
+	// Without boot ROM the CPU starts from the state the boot ROM leaves
+	if (!ROMReader::copy(mem, bootRom)) {
+		cpu->setBootROM(false);
+	}
+}
+
+bool Emulator::run() {
+	return cpu->run();
+}
+
+void Emulator::initialize() {
+	cpu->initialize();
+}
+
+void Emulator::runFrame() {
+	cpu->runFrame();
+}
+
+void Emulator::setButtons(uint8_t mask) {
+	cpu->getJoypad()->setButtons(mask);
+}
+
+const uint8_t* Emulator::getFrameBuffer() {
+	return cpu->getGPU()->getFrameBuffer();
+}
+
+Emulator* Emulator::clone() {
+	Emulator* e = new Emulator(true);
+	e->copyFrom(*this);
+	return e;
+}
+
+void Emulator::copyFrom(const Emulator& other) {
+	mem->copyState(*other.mem);
+	cpu->copyState(*other.cpu);
+}
+
+CPU* Emulator::getCPU() {
+	return cpu;
+}
+
+Memory* Emulator::getMemory() {
+	return mem;
+}
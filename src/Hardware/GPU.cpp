@@ -1,14 +1,33 @@
 #include "../Component/GPU.h"
 #include "../Component/Interrupts.h"
+#include "../Component/Config.h"
+#include "../Component/SaveState.h"
+#include "../Component/Trace.h"
 
 #include <stdio.h>
+#include <cstring>
 #include <queue>
 
 /* Constructor */
-GPU::GPU(Memory* m) {
+GPU::GPU(Memory* m, bool headless) {
 	mem = m;
 	gpuTicks = 0;
-	gui = new GUI();
+	presenter = headless ? NULL : new Presenter();
+	movie = NULL;
+	sharedFrame = NULL;
+	video = NULL;
+	frameLog = NULL;
+
+	// Register for LCD register writes and load current register state
+	mem->setGPU(this);
+	syncRegisters();
+
+	renderEnabled = true;
+	speculative = false;
+	frameCounter = 0;
+	renderedFrames = 0;
+	skippedFrames = 0;
+	renderCurrentFrame = isFrameRendered();
 
 	// Initialize frameBuffer
 	for(int i = 0; i < SCREEN_HEIGHT; i++) {
@@ -18,67 +37,71 @@ GPU::GPU(Memory* m) {
 	}
 }
 
+GPU::~GPU() {
+	delete presenter;
+}
+
 /* Private Methods */
 bool GPU::isLCDenabled() {
-	return (mem->read_8u(LCD_CTRL_REG) >> 7) & 0x1;
+	return (lcdc >> 7) & 0x1;
 }
 
 /* 0 = 9800-9BFF, 1 = 9C00-9FFF */
 bool GPU::windowMapSelect() {
-	return (mem->read_8u(LCD_CTRL_REG) >> 6) & 0x1;		
+	return (lcdc >> 6) & 0x1;		
 }
 
 bool GPU::isWindowEnabled() {
-	return (mem->read_8u(LCD_CTRL_REG) >> 5) & 0x1;
+	return (lcdc >> 5) & 0x1;
 }
 
 
 /* 0 = 8800-97FF 1 = 8000-8FFF */
 bool GPU::tileDataSelect() { 
-	return (mem->read_8u(LCD_CTRL_REG) >> 4) & 0x1;
+	return (lcdc >> 4) & 0x1;
 }
 
 /* 0 = 9800-9BFF, 1 =  1=9C00-9FFF */
 bool GPU::backgroundMapSelect() {
-	return (mem->read_8u(LCD_CTRL_REG) >> 3) & 0x1;
+	return (lcdc >> 3) & 0x1;
 }
 
 /* 0 = 8x8, 1 = 8x16 */
 bool GPU::isSpriteSizeLarge() {
-	return (mem->read_8u(LCD_CTRL_REG) >> 2) & 0x1;
+	return (lcdc >> 2) & 0x1;
 }
 
 bool GPU::isSpriteDisplayEnabled() { 
-	return (mem->read_8u(LCD_CTRL_REG) >> 1) & 0x1;
+	return (lcdc >> 1) & 0x1;
 }
 
 bool GPU::isBackgroundDisplayEnabled() {
-	return mem->read_8u(LCD_CTRL_REG) & 0x1;
+	return lcdc & 0x1;
 }
 
 bool GPU::isHBlankInterruptRequested() {
-	return ((mem->read_8u(LCD_STAT_REG) >> 3) & 0x1);
+	return ((stat >> 3) & 0x1);
 }
 
 bool GPU::isVBlankInterruptRequested() {
-	return ((mem->read_8u(LCD_STAT_REG) >> 4) & 0x1);
+	return ((stat >> 4) & 0x1);
 }
 
 bool GPU::isOAMInterruptRequested() {
-	return ((mem->read_8u(LCD_STAT_REG) >> 5) & 0x1);
+	return ((stat >> 5) & 0x1);
 }
 
 bool GPU::isLYCInterruptRequested() {
-	return ((mem->read_8u(LCD_STAT_REG) >> 6) & 0x1);
+	return ((stat >> 6) & 0x1);
 }
 
 void GPU::setCoincidenceFlag(bool coincidenceFlag) {
-	uint8_t current = mem->read_8u(LCD_STAT_REG);
 	if (coincidenceFlag) {
-		mem->write_8u(LCD_STAT_REG, current | (1 << 2));
+		stat |= (1 << 2);
 	} else {
-		mem->write_8u(LCD_STAT_REG, current & ~(1 << 2));
+		stat &= ~(1 << 2);
 	}
+	mem->privilegedWrite8u(LCD_STAT_REG, stat);
 }
 
 bool GPU::isTileUnsigned() {
@@ -90,15 +113,15 @@ bool GPU::isTileUnsigned() {
 }
 
 uint8_t GPU::getScanline() {
-	return mem->read_8u(LCD_CUR_SCANLINE);
+	return ly;
 }
 
 uint8_t GPU::getLYC() {
-	return mem->read_8u(LCD_LYC);
+	return lyc;
 }
 
 uint8_t GPU::getLCDMode() {
-	return mem->read_8u(LCD_CTRL_REG) & 0x3;
+	return stat & 0x3;
 }
 
 bool GPU::isLCDMode(GPUMode mode) {
@@ -106,26 +129,24 @@ bool GPU::isLCDMode(GPUMode mode) {
 }
 
 void GPU::updateLCDMode(GPUMode mode) {
-	uint8_t currentMode = mem->read_8u(LCD_STAT_REG);
-	currentMode &= ~3;
-	mem->privilegedWrite8u(LCD_STAT_REG, (currentMode | mode));
+	stat = (stat & ~3) | mode;
+	mem->privilegedWrite8u(LCD_STAT_REG, stat);
 }
 
 uint8_t GPU::getScrollX() {
-	return mem->read_8u(SCROLL_X);
+	return scrollX;
 }
 uint8_t GPU::getScrollY() {
-	return mem->read_8u(SCROLL_Y);
+	return scrollY;
 }
 uint8_t GPU::getWindowX() {
-	return mem->read_8u(WINDOW_X);
+	return windowX;
 }
 uint8_t GPU::getWindowY() {
-	return mem->read_8u(WINDOW_Y);
+	return windowY;
 }
 
-uint8_t GPU::getColorPaletteFromNumber(uint8_t color, uint16_t PALETTE) {
-	uint8_t palette = mem->read_8u(PALETTE);
+uint8_t GPU::getColorPaletteFromNumber(uint8_t color, uint8_t palette) {
 	return (palette >> (color * 2)) & 0x3;
 }
 
@@ -190,17 +211,17 @@ void GPU::renderTile() {
 		// Separate between unsigned and signed tile identifier
 		if (isTileUnsigned()) {
 			// Calculate address of tile data with unsigned identifier
-			uint8_t tileNum = mem->read_8u(tileAddress);
+			uint8_t tileNum = mem->privilegedRead8u(tileAddress);
 			tileLocation = getActiveTileMemory() + tileNum*16;
 		} else {
 			// Calculate address of tile data with signed identifier
-			int8_t tileNum = mem->read_8s(tileAddress);
+			int8_t tileNum = (int8_t) mem->privilegedRead8u(tileAddress);
 			tileLocation = getActiveTileMemory() + (tileNum+128) * 16;
 		}
 
 		// Get color of current pixel
 		uint8_t colorNum = getTilePixelValue(tileLocation, posX, posY);
-		uint8_t color = getColorPaletteFromNumber(colorNum, MONOCHROME_COLOR_PALETTE);
+		uint8_t color = getColorPaletteFromNumber(colorNum, bgPalette);
 
 		// Check if scanline is in range
 		if (getScanline() < 144) {
@@ -250,7 +271,7 @@ void GPU::renderSprite() {
 				continue;
 			}
 
-			uint8_t color = getColorPaletteFromNumber(colorNum, getActiveColorPaletteAddress(i));
+			uint8_t color = getColorPaletteFromNumber(colorNum, getActiveColorPalette(i));
 
 			uint8_t posX = getSpritePosX(i) + ((0 - pixel) + 7);
 
@@ -278,8 +299,8 @@ uint8_t GPU::getSpriteLine(uint8_t index) {
 	return (uint8_t) line;
 }
 
-uint16_t GPU::getActiveColorPaletteAddress(uint8_t index) {
-	return ((getSpriteAttribute(index) >> 4) & 0x1) ? OBJECT_PALETTE_1 : OBJECT_PALETTE_0;
+uint8_t GPU::getActiveColorPalette(uint8_t index) {
+	return ((getSpriteAttribute(index) >> 4) & 0x1) ? objPalette1 : objPalette0;
 }
 
 uint8_t GPU::getSpriteSizeY() {
@@ -296,19 +317,19 @@ bool GPU::getSpriteBackgroundPriority(uint8_t index) {
 
 
 uint8_t GPU::getSpritePosY(uint8_t index) {
-	return mem->read_8u(SPRITE_OAM + index*4) - 16;
+	return mem->privilegedRead8u(SPRITE_OAM + index*4) - 16;
 }
 
 uint8_t GPU::getSpritePosX(uint8_t index) {
-	return mem->read_8u(SPRITE_OAM + index*4 + 1) - 8;
+	return mem->privilegedRead8u(SPRITE_OAM + index*4 + 1) - 8;
 }
 
 uint8_t GPU::getSpriteTileLocation(uint8_t index) {
-	return mem->read_8u(SPRITE_OAM + index*4 + 2);
+	return mem->privilegedRead8u(SPRITE_OAM + index*4 + 2);
 }
 
 uint8_t GPU::getSpriteAttribute(uint8_t index) {
-	return mem->read_8u(SPRITE_OAM + index*4 + 3);
+	return mem->privilegedRead8u(SPRITE_OAM + index*4 + 3);
 }
 
 bool GPU::isSpriteFlipY(uint8_t attribute) {
@@ -324,8 +345,8 @@ uint8_t GPU::getTilePixelValue(uint16_t tileLineAddress, uint8_t x, uint8_t y) {
 	uint8_t line = (y % 8) * 2;
 
 	// Read both tile lines from memory
-	uint8_t tileByte1 = mem->read_8u(tileLineAddress + line);
-	uint8_t tileByte2 = mem->read_8u(tileLineAddress + line + 1);
+	uint8_t tileByte1 = mem->privilegedRead8u(tileLineAddress + line);
+	uint8_t tileByte2 = mem->privilegedRead8u(tileLineAddress + line + 1);
 
 	// Calculate pixel position in tile
 	int8_t bit = x % 8;
@@ -341,8 +362,8 @@ uint8_t GPU::getTilePixelValue(uint16_t tileLineAddress, uint8_t x, uint8_t y) {
 }
 
 uint8_t GPU::getSpritePixelValue(uint8_t index, int8_t pixel, uint16_t address) {
-	uint8_t spriteByte1 = mem->read_8u(address);
-	uint8_t spriteByte2 = mem->read_8u(address + 1);
+	uint8_t spriteByte1 = mem->privilegedRead8u(address);
+	uint8_t spriteByte2 = mem->privilegedRead8u(address + 1);
 
 	if (isSpriteFlipX(getSpriteAttribute(index))) {
 		pixel = 7 - pixel;
@@ -355,26 +376,83 @@ uint8_t GPU::getSpritePixelValue(uint8_t index, int8_t pixel, uint16_t address)
 }
 
 void GPU::incrementScanLine() {
-	mem->privilegedWrite8u(LCD_CUR_SCANLINE, mem->read_8u(LCD_CUR_SCANLINE) + 1);
+	ly++;
+	mem->privilegedWrite8u(LCD_CUR_SCANLINE, ly);
 }
 
 void GPU::resetScanLine() {
-	mem->privilegedWrite8u(LCD_CUR_SCANLINE, 0);
+	ly = 0;
+	mem->privilegedWrite8u(LCD_CUR_SCANLINE, ly);
 }
 
 void GPU::drawLine() {
+	TRACE_SCOPE("GPU::drawLine");
+
 	if (isBackgroundDisplayEnabled()) {
 		renderTile();
 	}
 
 	if (isSpriteDisplayEnabled()) {
+		// Only needed when sprites are drawn during a running OAM DMA
+		mem->syncDMA();
 		renderSprite();
 	}
 }
 
+/* Decide if the current frame is drawn, based on the configured frame skip */
+bool GPU::isFrameRendered() {
+	uint16_t frameSkip = Config::getFrameSkip();
+	if (frameSkip == 0 || !renderEnabled) {
+		return false;
+	}
+	return (frameCounter % frameSkip) == 0;
+}
+
+void GPU::finishFrame() {
+	if (renderCurrentFrame) {
+		if (presenter) {
+			presenter->submitFrame(frameBuffer);
+		}
+		if (video) {
+			video->submitFrame(frameBuffer);
+		}
+		if (sharedFrame && !speculative) {
+			sharedFrame->publishFrame(frameBuffer, frameCounter);
+		}
+		if (frameLog && !speculative && !frameLog->addFrame(frameBuffer, frameCounter)) {
+			Config::requestQuit();
+		}
+		renderedFrames++;
+	} else {
+		skippedFrames++;
+	}
+
+	// Frames run ahead are rolled back, they must not consume or record input
+	if (speculative) {
+		frameCounter++;
+		renderCurrentFrame = isFrameRendered();
+		return;
+	}
+
+	// A replayed movie replaces the input and stops at its end
+	if (movie && !movie->isRecording()) {
+		if (!movie->update(mem->getJoypad())) {
+			Config::requestQuit();
+		}
+	} else {
+		handleEvents();
+		if (movie) {
+			movie->update(mem->getJoypad());
+		}
+	}
+
+	frameCounter++;
+	renderCurrentFrame = isFrameRendered();
+}
+
 void GPU::triggerInterrupt(uint8_t type) {
-	uint8_t current = mem->read_8u(INTERRUPT_REQUEST_REGISTER);
-	mem->write_8u(INTERRUPT_REQUEST_REGISTER, (current | type));
+	uint8_t current = mem->privilegedRead8u(INTERRUPT_REQUEST_REGISTER);
+	mem->privilegedWrite8u(INTERRUPT_REQUEST_REGISTER, (current | type));
 }
 
 /* Public Methods */
@@ -445,12 +523,13 @@ void GPU::update(uint8_t cycles) {
 		gpuTicks -= 456;
 
 		if (getScanline() < 144) {
-			drawLine();
+			if (renderCurrentFrame) {
+				drawLine();
+			}
 		}
 		else if (getScanline() == 144) {
 			triggerInterrupt(GPU_V_BLANK);
-			gui->render(frameBuffer);
-			gui->handleEvents();
+			finishFrame();
 		}
 		else if (getScanline() > 153) {
 			resetScanLine();
@@ -462,5 +541,170 @@ void GPU::update(uint8_t cycles) {
 }
 
 void GPU::handleEvents() {
-	gui->handleEvents();
-}
\ No newline at end of file
+	if (presenter) {
+		presenter->pollInput(mem->getJoypad());
+	}
+	if (sharedFrame) {
+		sharedFrame->pollInput(mem->getJoypad());
+	}
+}
+
+void GPU::presentFrame() {
+	if (presenter) {
+		presenter->submitFrame(frameBuffer);
+	}
+	if (sharedFrame) {
+		sharedFrame->publishFrame(frameBuffer, frameCounter);
+	}
+	handleEvents();
+}
+
+void GPU::setOverlay(const std::string& text) {
+	if (presenter) {
+		presenter->setOverlay(text);
+	}
+}
+
+bool GPU::isHeadless() {
+	return presenter == NULL;
+}
+
+const uint8_t* GPU::getFrameBuffer() {
+	return &frameBuffer[0][0];
+}
+
+void GPU::setMovie(Movie* m) {
+	movie = m;
+}
+
+void GPU::setSharedFrame(SharedFrame* s) {
+	sharedFrame = s;
+}
+
+void GPU::setVideoWriter(VideoWriter* v) {
+	video = v;
+}
+
+void GPU::setFrameLog(FrameLog* f) {
+	frameLog = f;
+}
+
+void GPU::writeRegister(uint16_t addr, uint8_t value) {
+	switch(addr) {
+		case LCD_CTRL_REG:
+			lcdc = value;
+			return;
+		case LCD_STAT_REG:
+			// Mode and coincidence bits are read only
+			stat = (value & ~0x7) | (stat & 0x7);
+			mem->privilegedWrite8u(LCD_STAT_REG, stat);
+			return;
+		case SCROLL_Y:
+			scrollY = value;
+			return;
+		case SCROLL_X:
+			scrollX = value;
+			return;
+		case LCD_CUR_SCANLINE:
+			ly = value;
+			return;
+		case LCD_LYC:
+			lyc = value;
+			return;
+		case MONOCHROME_COLOR_PALETTE:
+			bgPalette = value;
+			return;
+		case OBJECT_PALETTE_0:
+			objPalette0 = value;
+			return;
+		case OBJECT_PALETTE_1:
+			objPalette1 = value;
+			return;
+		case WINDOW_Y:
+			windowY = value;
+			return;
+		case WINDOW_X:
+			windowX = value;
+			return;
+		default:
+			return;
+	}
+}
+
+void GPU::setRendering(bool enabled) {
+	renderEnabled = enabled;
+	renderCurrentFrame = isFrameRendered();
+}
+
+void GPU::setSpeculative(bool enabled) {
+	speculative = enabled;
+}
+
+unsigned long GPU::getFrameCount() {
+	return frameCounter;
+}
+
+unsigned long GPU::getRenderedFrames() {
+	return renderedFrames;
+}
+
+unsigned long GPU::getSkippedFrames() {
+	return skippedFrames;
+}
+
+void GPU::printFrameStats() {
+	printf("== Frames rendered: %lu, skipped: %lu\n", renderedFrames, skippedFrames);
+}
+
+void GPU::syncRegisters() {
+	lcdc = mem->privilegedRead8u(LCD_CTRL_REG);
+	stat = mem->privilegedRead8u(LCD_STAT_REG);
+	scrollY = mem->privilegedRead8u(SCROLL_Y);
+	scrollX = mem->privilegedRead8u(SCROLL_X);
+	ly = mem->privilegedRead8u(LCD_CUR_SCANLINE);
+	lyc = mem->privilegedRead8u(LCD_LYC);
+	bgPalette = mem->privilegedRead8u(MONOCHROME_COLOR_PALETTE);
+	objPalette0 = mem->privilegedRead8u(OBJECT_PALETTE_0);
+	objPalette1 = mem->privilegedRead8u(OBJECT_PALETTE_1);
+	windowY = mem->privilegedRead8u(WINDOW_Y);
+	windowX = mem->privilegedRead8u(WINDOW_X);
+}
+
+void GPU::saveState(StateWriter& w) {
+	w.write(gpuTicks);
+	w.write(frameBuffer, sizeof(frameBuffer));
+	w.write(renderCurrentFrame);
+	w.write(frameCounter);
+}
+
+void GPU::loadState(StateReader& r) {
+	r.read(gpuTicks);
+	r.read(frameBuffer, sizeof(frameBuffer));
+	r.read(renderCurrentFrame);
+	r.read(frameCounter);
+
+	// Frame skip is configuration, a state saved with another one must not render
+	renderCurrentFrame = isFrameRendered();
+
+	syncRegisters();
+}
+
+void GPU::copyState(const GPU& other) {
+	gpuTicks = other.gpuTicks;
+	memcpy(frameBuffer, other.frameBuffer, sizeof(frameBuffer));
+
+	lcdc = other.lcdc;
+	stat = other.stat;
+	scrollY = other.scrollY;
+	scrollX = other.scrollX;
+	ly = other.ly;
+	lyc = other.lyc;
+	bgPalette = other.bgPalette;
+	objPalette0 = other.objPalette0;
+	objPalette1 = other.objPalette1;
+	windowY = other.windowY;
+	windowX = other.windowX;
+
+	renderCurrentFrame = other.renderCurrentFrame;
+	frameCounter = other.frameCounter;
+}
@@ -1,8 +1,14 @@
 #include "../Component/Joypad.h"
 
-/* Instantiate static member variable */
-bool Joypad::buttons[] = {false};
-Memory* Joypad::mem;
+/* Constructor */
+Joypad::Joypad(Memory* m) {
+	mem = m;
+	for(int i = 0; i < 10; i++) {
+		buttons[i] = false;
+	}
+
+	mem->setJoypad(this);
+}
 
 void Joypad::pressButton(Button b) {
 	bool buttonChanged = !buttons[static_cast<int>(b)];
@@ -14,7 +20,7 @@ void Joypad::pressButton(Button b) {
 		return;
 	}
 
-	uint8_t value = mem->read_8u(0xFF00);
+	uint8_t value = mem->privilegedRead8u(0xFF00);
 
 	bool buttonInteresting = false;
 
@@ -32,8 +38,8 @@ void Joypad::pressButton(Button b) {
 
 	// Trigger interrupt
 	if (buttonChanged && buttonInteresting) {
-		uint8_t current = mem->read_8u(0xFF0F);
-		mem->write_8u(0xFF0F, (current | 0x60));
+		uint8_t current = mem->privilegedRead8u(0xFF0F);
+		mem->privilegedWrite8u(0xFF0F, (current | 0x60));
 	}
 
 }
@@ -46,7 +52,7 @@ void Joypad::releaseButton(Button b) {
 		return;
 	}
 
-	uint8_t value = mem->read_8u(0xFF00);
+	uint8_t value = mem->privilegedRead8u(0xFF00);
 
 	// If button is currently interesting -> set bit (since 1 means not pressed)
 	if (((value >> 4) & 1) && (b == Button::A || b == Button::B || b == Button::Start || b == Button::Select)) {
@@ -91,4 +97,18 @@ bool Joypad::isAnyButtonPressed() {
 	}
 
 	return false;
-}
\ No newline at end of file
+}
+
+void Joypad::setButtons(uint8_t mask) {
+	for(int i = 0; i < 8; i++) {
+		bool pressed = (mask >> i) & 1;
+		if (pressed == buttons[i]) {
+			continue;
+		}
+		if (pressed) {
+			pressButton(static_cast<Button>(i));
+		} else {
+			releaseButton(static_cast<Button>(i));
+		}
+	}
+}
@@ -1,6 +1,12 @@
 #include "../Component/Memory.h"
 #include "../Component/Config.h"
 #include "../Component/Joypad.h"
+#include "../Component/GPU.h"
+#include "../Component/Timer.h"
+#include "../Component/SaveState.h"
+#include "../Component/Trace.h"
+#include "../Component/Breakpoints.h"
+#include "../Component/CodeLog.h"
 
 #include <cstring>
 #include <iostream>
@@ -13,6 +19,34 @@ Memory::Memory() {
 	bankMode = 0;
 	romBank = 1;
 	ramBank = 0;
+	gpu = NULL;
+	timer = NULL;
+	joypad = NULL;
+	initializeIOHandlers();
+
+	// All memories share one empty cartridge until a ROM is loaded
+	static std::shared_ptr<std::vector<uint8_t> > emptyCartridge = std::make_shared<std::vector<uint8_t> >(CARTRIDGE_SIZE, 0);
+	cartridge = emptyCartridge;
+
+	dmaActive = false;
+	dmaSource = 0;
+	dmaTicks = 0;
+	dmaCopied = 0;
+
+	ticks = 0;
+	romBankCount = 2;
+	bankSwitches = 0;
+	isRAMEnabled = 0;
+	rtcSelect = 0;
+	rtcLatch = 0xFF;
+	rtcTime = 0;
+	rtcBase = 0;
+	memset(rtcRegister, 0, sizeof(rtcRegister));
+	selectMapper();
+
+	memset(watchPages, 0, sizeof(watchPages));
+	watchpoints = NULL;
+	codeLog = NULL;
 
 	/* Set whole Memory to 0b11111111 (0xFF) at start.
 	for(int i = 0; i < MEM_SIZE; i++) {
@@ -21,6 +55,36 @@ Memory::Memory() {
 	*/
 }
 
+void Memory::setGPU(GPU* g) {
+	gpu = g;
+
+	for(int i = 0x40; i <= 0x4B; i++) {
+		ioWrite[i] = &Memory::writeLCD;
+	}
+	ioWrite[0x44] = &Memory::writeScanline;
+	ioWrite[0x46] = &Memory::writeDMA;
+}
+
+void Memory::setTimer(Timer* t) {
+	timer = t;
+
+	ioRead[0x04] = &Memory::readTimer;
+	ioRead[0x05] = &Memory::readTimer;
+	ioWrite[0x04] = &Memory::writeTimer;
+	ioWrite[0x05] = &Memory::writeTimer;
+	ioWrite[0x07] = &Memory::writeTimer;
+}
+
+void Memory::setJoypad(Joypad* j) {
+	joypad = j;
+
+	ioWrite[0x00] = &Memory::writeJoypad;
+}
+
+Joypad* Memory::getJoypad() {
+	return joypad;
+}
+
 /* Methods */
 void Memory::initialize() {
 	// Copy Cartidge into GBs address space
@@ -62,226 +126,226 @@ void Memory::initialize() {
 			break;
 	}
 	printf("== Current Banking Controller: %d\n", bankingController);
+
+	// ROM size in header 0x148 is 32KB << n
+	uint8_t romSize = read_8u(0x148);
+	romBankCount = (romSize <= 8) ? (2 << romSize) : 512;
+
+	selectMapper();
 }
 
-void Memory::remapUnit() {
-	if (read_8u(0xFF50) == 1 && !isMapped) {
+bool Memory::remapUnit() {
+	if (privilegedRead8u(0xFF50) == 1 && !isMapped) {
 		copyFromCartridge(0x0, 0x0, 0xFF);
 		isMapped = 1;
+		return true;
 	}
+	return false;
 }
 
-void Memory::bankUnit(uint16_t addr, uint8_t value) {
+void Memory::selectMapper() {
+	// Every MBC shares the RAM enable register at 0x0000-0x1FFF
+	bankRegister[0] = &Memory::writeRAMEnable;
+
 	switch(bankingController) {
-		// No MBC
-		case 0:
-			return;
-		// MBC1
 		case 1:
-			handleMBC1(addr, value);
-			return;
-		// MBC2
+			bankRegister[1] = &Memory::writeMBC1ROMBank;
+			bankRegister[2] = &Memory::writeMBC1HighBank;
+			bankRegister[3] = &Memory::writeMBC1Mode;
+			break;
 		case 2:
-			handleMBC2(addr, value);
-			return;
-		//MBC3
+			// MBC2 selects RAM enable or ROM bank by address bit 8 in 0x0000-0x3FFF
+			bankRegister[0] = &Memory::writeMBC2Register;
+			bankRegister[1] = &Memory::writeMBC2Register;
+			bankRegister[2] = &Memory::writeNoMBC;
+			bankRegister[3] = &Memory::writeNoMBC;
+			break;
 		case 3:
-			handleMBC3(addr, value);
-			return;
-		case 4: 
-			handleMBC4(addr, value);
-			return;
-		case 5: 
-			handleMBC5(addr, value);
-			return;
+			bankRegister[1] = &Memory::writeMBC3ROMBank;
+			bankRegister[2] = &Memory::writeMBC3RAMBank;
+			bankRegister[3] = &Memory::writeMBC3Latch;
+			break;
+		case 4:
+		case 5:
+			bankRegister[1] = &Memory::writeMBC5ROMBank;
+			bankRegister[2] = &Memory::writeMBC5RAMBank;
+			bankRegister[3] = &Memory::writeNoMBC;
+			break;
 		default:
-			printf("Current Memory Banking Controller not supported!\n");
-			return;
+			bankRegister[0] = &Memory::writeNoMBC;
+			bankRegister[1] = &Memory::writeNoMBC;
+			bankRegister[2] = &Memory::writeNoMBC;
+			bankRegister[3] = &Memory::writeNoMBC;
+			break;
 	}
 }
 
+void Memory::bankUnit(uint16_t addr, uint8_t value) {
+	(this->*bankRegister[addr >> 13])(addr, value);
+}
 
-void Memory::handleMBC1(uint16_t addr, uint8_t value) {
-	// Handle RAM Banking
-	if(addr >= 0x0000 && addr <= 0x1FFF) {
-		if ((value & 0xF) == 0xA) {
-			// Enable RAM
-			isRAMEnabled = 1;
-			//printf("---- Enable RAM Banking!\n");
-		}
-		else if ((value & 0xF) == 0x0) {
-			// Disable RAM
-			isRAMEnabled = 0;
-			//printf("---- Disable RAM Banking!\n");
-		}
-	}
-	// Handle Lo ROM Banking
-	if (addr >= 0x2000 && addr <= 0x3FFF) {
-		// Prevent setting romBank to 0h, 20h, 40h, 60h
-		if ((value & 0x1F) == 0) {
-			value = 1;
-		}
+void Memory::switchROMBank(uint16_t bank) {
+	TRACE_SCOPE("Memory::switchROMBank");
 
-		// Clear and set the lower 5 bits of romBank
-		romBank &= 0xE0;
-		romBank |= (value & 0x1F);
-		// Switch ROM Banks in memory
-		copyFromCartridge(0x4000, romBank*0x4000, getSize(0x4000, 0x8000));
-	}
-	// Handle Hi ROM Banking OR RAM Banking
-	if (addr >= 0x4000 && addr <= 0x5FFF) {
-		//printf("Hi Banking! Current value: %d \n", value);
-		if (bankMode == 0) {
-			// ROM Banking Mode
-			// Clear and set the upper 3 bits of romBank
-			romBank &= 0x1F;
-			romBank |= (value & 0xE0);
-
-			// Switch ROM Banks in memory
-			copyFromCartridge(0x4000, romBank*0x4000, getSize(0x4000, 0x8000));
-		} else {
-			// RAM Banking Mode
-			copyToRAM(ramBank*0x2000, 0xA000, getSize(0xA000, 0xC000));
-			ramBank = (value & 0x3);
-			copyFromRAM(0xA000, ramBank*0x2000, getSize(0xA000, 0xC000));
-		}
-	}
-	// Handle ROM/RAM Mode Select
-	if (addr >= 0x6000 && addr <= 0x7FFF) {
-		bankMode = (value & 0x1);
+	bankSwitches++;
+	romBank = bank & (romBankCount - 1);
+	copyFromCartridge(0x4000, romBank*0x4000, getSize(0x4000, 0x8000));
+}
 
-		if (bankMode == 0) {
-			ramBank = 0;
-		}
+void Memory::switchRAMBank(uint8_t bank) {
+	TRACE_SCOPE("Memory::switchRAMBank");
+
+	bankSwitches++;
+	// Keep RAM contents, unless the RTC is mapped at 0xA000
+	if (rtcSelect == 0) {
+		storeRAM();
 	}
-	return;
+	rtcSelect = 0;
+	ramBank = bank & (RAM_BANKS - 1);
+	loadRAM();
 }
 
-void Memory::handleMBC2(uint16_t addr, uint8_t value) {
-	//TODO handle MBC2
+/* No MBC: writes to ROM are ignored */
+void Memory::writeNoMBC(uint16_t addr, uint8_t value) {
 	return;
 }
 
-void Memory::handleMBC3(uint16_t addr, uint8_t value) {
-	// Handle RAM Banking
-	if(addr >= 0x0000 && addr <= 0x1FFF) {
-		if ((value & 0xF) == 0xA) {
-			// Enable RAM
-			// TODO: Check for RTC register
-			isRAMEnabled = 1;
-		}
-		else if ((value & 0xF) == 0x0) {
-			// Disable RAM
-			// TODO: Check for RTC register
-			isRAMEnabled = 0;
-		}
+/* 0x0000-0x1FFF: Enable RAM (and RTC) with 0xA in the lower nibble */
+void Memory::writeRAMEnable(uint16_t addr, uint8_t value) {
+	isRAMEnabled = ((value & 0xF) == 0xA);
+}
+
+/* MBC1 0x2000-0x3FFF: Lower 5 bits of romBank, 0 selects bank 1 */
+void Memory::writeMBC1ROMBank(uint16_t addr, uint8_t value) {
+	uint8_t low = value & 0x1F;
+	if (low == 0) {
+		low = 1;
 	}
-	// Handle ROM/RAM Mode Select
-	if (addr >= 0x0000 && addr <= 0x1fff) {
-		bankMode = (value & 0x1);
-		
-		if (bankMode == 0) {
-			ramBank = 0;
-		}
+	switchROMBank((romBank & 0x60) | low);
+}
+
+/* MBC1 0x4000-0x5FFF: Upper 2 bits of romBank OR ramBank */
+void Memory::writeMBC1HighBank(uint16_t addr, uint8_t value) {
+	if (bankMode == 0) {
+		switchROMBank((romBank & 0x1F) | ((value & 0x3) << 5));
+	} else {
+		switchRAMBank(value & 0x3);
 	}
-	// HANDLE RAM BANKING
+}
+
+/* MBC1 0x6000-0x7FFF: ROM/RAM Mode Select */
+void Memory::writeMBC1Mode(uint16_t addr, uint8_t value) {
+	bankMode = (value & 0x1);
 
-	// Handle Lo ROM Banking
-	if (addr >= 0x2000 && addr <= 0x3FFF) {
-		// bank 0 -> bank 1
-		if (value == 0)
-			value = 1;
-		// Clear and set the lower 7 bits of romBank
-		romBank &= 0x80;
-		romBank |= (value & 0x7f);
-		// Switch ROM Banks in memory
-		copyFromCartridge(0x4000, romBank*0x4000, getSize(0x4000, 0x8000));
+	if (bankMode == 0) {
+		switchRAMBank(0);
 	}
-	
-	if (addr >= 0x4000 && addr <= 0x5FFF) {
-		if (bankMode == 0) {
-			// ROM Banking Mode
-			// Clear and set the upper 3 bits of romBank
-			romBank &= 0x1F;
-			romBank |= (value & 0xE0);
-			// Switch ROM Banks in memory
-			copyFromCartridge(0x4000, romBank*0x4000, getSize(0x4000, 0x8000));
-		} else {
-			// RAM Banking Mode
-			copyToRAM(ramBank*0x2000, 0xA000, getSize(0xA000, 0xC000));
-			ramBank = (value & 0x3);
-			copyFromRAM(0xA000, ramBank*0x2000, getSize(0xA000, 0xC000));
+}
+
+/* MBC2 0x0000-0x3FFF: Bit 8 of the address selects RAM enable (0) or ROM bank (1) */
+void Memory::writeMBC2Register(uint16_t addr, uint8_t value) {
+	if (addr & 0x100) {
+		uint8_t bank = value & 0xF;
+		if (bank == 0) {
+			bank = 1;
 		}
-	}			
-	return;
+		switchROMBank(bank);
+	} else {
+		writeRAMEnable(addr, value);
+	}
 }
 
-void Memory::handleMBC4(uint16_t addr, uint8_t value) {
-	return;
+/* MBC3 0x2000-0x3FFF: 7 bit romBank, 0 selects bank 1 */
+void Memory::writeMBC3ROMBank(uint16_t addr, uint8_t value) {
+	uint8_t bank = value & 0x7F;
+	if (bank == 0) {
+		bank = 1;
+	}
+	switchROMBank(bank);
 }
 
-void Memory::handleMBC5(uint16_t addr, uint8_t value) {
-	// Handle RAM Banking
-	if(addr >= 0x0000 && addr <= 0x1FFF) {
-		if ((value & 0xF) == 0xA) {
-			// Enable RAM
-			// TODO: Check for RTC register
-			isRAMEnabled = 1;
-		}
-		else if ((value & 0xF) == 0x0) {
-			// Disable RAM
-			// TODO: Check for RTC register
-			isRAMEnabled = 0;
+/* MBC3 0x4000-0x5FFF: 0x00-0x03 select a RAM bank, 0x08-0x0C an RTC register */
+void Memory::writeMBC3RAMBank(uint16_t addr, uint8_t value) {
+	if (value >= RTC_SECONDS && value <= RTC_DAYS_HIGH) {
+		if (rtcSelect == 0) {
+			storeRAM();
 		}
+		rtcSelect = value;
+		mapRTC();
+	}
+	else if (value <= 0x3) {
+		switchRAMBank(value);
 	}
-	// Handle ROM/RAM Mode Select
-	if (addr >= 0x0000 && addr <= 0x1fff) {
-		bankMode = (value & 0x1);
-		
-		if (bankMode == 0) {
-			ramBank = 0;
+}
+
+/* MBC3 0x6000-0x7FFF: Writing 0 then 1 latches the current time into the RTC registers */
+void Memory::writeMBC3Latch(uint16_t addr, uint8_t value) {
+	if (rtcLatch == 0 && value == 1) {
+		latchRTC();
+		if (rtcSelect != 0) {
+			mapRTC();
 		}
 	}
-	// HANDLE RAM BANKING
+	rtcLatch = value;
+}
 
-	// Handle Lo ROM Banking
-	if (addr >= 0x2000 && addr <= 0x3FFF) {
-		// bank 0 -> bank 1
-		if (value == 0)
-			value = 1;
-		// Clear and set the lower  8 bits of romBank
-		romBank &= 0x100;
-		romBank |= (value & 0xFF);
-		// Switch ROM Banks in memory
-		copyFromCartridge(0x4000, romBank*0x4000, getSize(0x4000, 0x8000));
+/* MBC5 0x2000-0x2FFF: Lower 8 bits of romBank, 0x3000-0x3FFF: 9th bit. Bank 0 is allowed */
+void Memory::writeMBC5ROMBank(uint16_t addr, uint8_t value) {
+	if (addr < 0x3000) {
+		switchROMBank((romBank & 0x100) | value);
+	} else {
+		switchROMBank((romBank & 0xFF) | ((value & 0x1) << 8));
 	}
-	
-	if (addr >= 0x3000 && addr <= 0x3FFF) {
-		// Clear and set the 9th bit of romBank
-		romBank &= 0xFF;
-		romBank |= ((value & 0x1) << 8); 
-		// Switch ROM Banks in memory
-		copyFromCartridge(0x4000, romBank*0x4000, getSize(0x4000, 0x8000));
-	}
-	if (addr >= 0x4000 && addr <= 0x5FFF) {
-		if (bankMode == 0) {
-			// ROM Banking Mode
-			// Clear and set the upper 3 bits of romBank
-			romBank &= 0x1F;
-			romBank |= (value & 0xE0);
-			// Switch ROM Banks in memory
-			copyFromCartridge(0x4000, romBank*0x4000, getSize(0x4000, 0x8000));
-		} else {
-			// RAM Banking Mode
-			copyToRAM(ramBank*0x2000, 0xA000, getSize(0xA000, 0xC000));
-			ramBank = (value & 0x3);
-			copyFromRAM(0xA000, ramBank*0x2000, getSize(0xA000, 0xC000));
-		}
-	}			
-	return;
+}
+
+/* MBC5 0x4000-0x5FFF: ramBank */
+void Memory::writeMBC5RAMBank(uint16_t addr, uint8_t value) {
+	switchRAMBank(value & 0xF);
+}
+
+/* Seconds counted by the RTC, advancing with emulated time unless halted */
+unsigned long Memory::getRTCTime() {
+	if (rtcRegister[RTC_DAYS_HIGH - RTC_SECONDS] & RTC_HALT) {
+		return rtcTime;
+	}
+	return rtcTime + (ticks - rtcBase) / CLOCK_RATE;
+}
+
+void Memory::latchRTC() {
+	unsigned long time = getRTCTime();
+	unsigned long days = time / 86400;
+
+	rtcRegister[0] = time % 60;
+	rtcRegister[1] = (time / 60) % 60;
+	rtcRegister[2] = (time / 3600) % 24;
+	rtcRegister[3] = days & 0xFF;
+	rtcRegister[4] = (rtcRegister[4] & (RTC_HALT | RTC_CARRY)) | ((days >> 8) & 0x1);
+	if (days > 0x1FF) {
+		rtcRegister[4] |= RTC_CARRY;
+	}
+}
+
+/* Mirror the selected RTC register over 0xA000-0xBFFF */
+void Memory::mapRTC() {
+	memset(&memory[0xA000], rtcRegister[rtcSelect - RTC_SECONDS], getSize(0xA000, 0xC000));
+}
+
+void Memory::writeRTC(uint8_t value) {
+	// Continue counting from the written register values
+	latchRTC();
+	rtcRegister[rtcSelect - RTC_SECONDS] = value;
+
+	unsigned long days = ((rtcRegister[4] & 0x1) << 8) | rtcRegister[3];
+	rtcTime = days * 86400 + rtcRegister[2] * 3600 + rtcRegister[1] * 60 + rtcRegister[0];
+	rtcBase = ticks;
+
+	mapRTC();
 }
 
 void Memory::storeRAM() {
+	if (rtcSelect != 0) {
+		return;
+	}
 	copyToRAM(ramBank*0x2000, 0xA000, getSize(0xA000, 0xC000));
 }
 
@@ -298,70 +362,293 @@ bool Memory::isBanking(uint16_t addr, uint8_t value) {
 	return false;
 }
 
-/* Trigger Events for read request */
-// INFO: Not implemented yet, as there is only one workaround case for read requests
-uint8_t Memory::triggerEvent(uint16_t addr) {
-	switch(addr) {
-		case 0xFF01:
-			return 0xFF;
-		default:
-			return 0x0;
-	}
-}
-
-/* Trigger Events for write requests */
-void Memory::triggerEvent(uint16_t addr, uint8_t value) {
-	switch(addr) {
-		// Write requested layout for joypads to memory
-		case 0xFF00:
-			Joypad::triggerLayoutChange(value);
-			return;
-		
-		// Linkport I/O
-		case 0xFF02:
-			if (value & 0x3F) {
-				memory[0xFF02] = memory[0xFF02] & 0x3F;
-				uint8_t current = read_8u(0xFF0F);
-				write_8u(0xFF0F, (current | (1 << 3)));
-			}
-			return;
-		
-		// Reset timer divider to zero
-		case 0xFF04:
-			memory[addr] = 0;
-			return;
-		
-		// Reset scanline to zero
-		case 0xFF44:
-			memory[addr] = 0;
-			return;
-		
-		// Trigger DMA Transfer for Sprite Attributes table
-		case 0xFF46:
-			DMATransfer(value);
-			return;
-		
-		// If no trigger is available for address, return
-		default:
-			return;
+/* Unused bits of the sound registers 0xFF10-0xFF3F read as 1 */
+static const uint8_t AUDIO_READ_MASK[0x30] = {
+	0x80, 0x3F, 0x00, 0xFF, 0xBF,				// NR10-NR14
+	0xFF, 0x3F, 0x00, 0xFF, 0xBF,				// NR20-NR24
+	0x7F, 0xFF, 0x9F, 0xFF, 0xBF,				// NR30-NR34
+	0xFF, 0xFF, 0x00, 0x00, 0xBF,				// NR40-NR44
+	0x00, 0x00, 0x70,							// NR50-NR52
+	0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF,
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,		// Wave RAM
+	0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00
+};
+
+void Memory::initializeIOHandlers() {
+	for(int i = 0; i < IO_SIZE; i++) {
+		ioRead[i] = NULL;
+		ioWrite[i] = NULL;
+	}
+
+	// Linkport I/O
+	ioRead[0x01] = &Memory::readSerialData;
+	ioWrite[0x02] = &Memory::writeSerialControl;
+
+	// Sound
+	for(int i = 0x10; i < 0x40; i++) {
+		ioRead[i] = &Memory::readAudio;
+		ioWrite[i] = &Memory::writeAudio;
 	}
+
+	// DMA works without a GPU attached, Joypad, Timer and LCD handlers are set on attach
+	ioWrite[0x46] = &Memory::writeDMA;
+}
+
+/* Linkport I/O return 0xFF for unused serial interface */
+uint8_t Memory::readSerialData(uint16_t addr) {
+	return 0xFF;
+}
+
+/* Timer registers are computed on demand */
+uint8_t Memory::readTimer(uint16_t addr) {
+	return timer->readRegister(addr);
+}
+
+uint8_t Memory::readAudio(uint16_t addr) {
+	return memory[addr] | AUDIO_READ_MASK[addr - 0xFF10];
+}
+
+/* Write requested layout for joypads to memory */
+void Memory::writeJoypad(uint16_t addr, uint8_t value) {
+	joypad->triggerLayoutChange(value);
+}
+
+void Memory::writeSerialControl(uint16_t addr, uint8_t value) {
+	if (value & 0x3F) {
+		memory[0xFF02] = memory[0xFF02] & 0x3F;
+		uint8_t current = privilegedRead8u(0xFF0F);
+		privilegedWrite8u(0xFF0F, (current | (1 << 3)));
+	}
+}
+
+void Memory::writeTimer(uint16_t addr, uint8_t value) {
+	// Reset timer divider to zero
+	if (addr == 0xFF04) {
+		memory[addr] = 0;
+	}
+	timer->writeRegister(addr, value);
+}
+
+void Memory::writeAudio(uint16_t addr, uint8_t value) {
+	// Only the power bit of NR52 is writable, powering off clears all sound registers
+	if (addr == 0xFF26) {
+		memory[addr] = (value & 0x80);
+		if (!(value & 0x80)) {
+			memset(&memory[0xFF10], 0, 0xFF26 - 0xFF10);
+		}
+	}
+}
+
+/* Mirror LCD registers into the GPU */
+void Memory::writeLCD(uint16_t addr, uint8_t value) {
+	gpu->writeRegister(addr, value);
+}
+
+/* Reset scanline to zero */
+void Memory::writeScanline(uint16_t addr, uint8_t value) {
+	memory[addr] = 0;
+	gpu->writeRegister(addr, 0);
+}
+
+/* Trigger DMA Transfer for Sprite Attributes table */
+void Memory::writeDMA(uint16_t addr, uint8_t value) {
+	DMATransfer(value);
 }
 
 void Memory::DMATransfer(uint8_t data) {
-	uint16_t addr = data << 8;
-	for(int i = 0; i < 0xA0; i++) {
-		memory[0xFE00+i] = memory[addr+i];
+	dmaSource = data << 8;
+
+	// Sources above 0xDFFF read from echo RAM
+	if (dmaSource >= 0xE000) {
+		dmaSource -= 0x2000;
+	}
+
+	dmaActive = true;
+	dmaTicks = 0;
+	dmaCopied = 0;
+}
+
+void Memory::update(uint8_t cycles) {
+	ticks += cycles;
+
+	if (!dmaActive) {
+		return;
+	}
+
+	dmaTicks += cycles;
+	if (dmaTicks >= DMA_TICKS) {
+		dmaTicks = DMA_TICKS;
+		syncDMA();
+		dmaActive = false;
+	}
+}
+
+void Memory::syncDMA() {
+	if (!dmaActive) {
+		return;
+	}
+
+	// The CPU cannot write the source while the transfer runs, so copying late is exact
+	uint8_t target = dmaTicks / 4;
+	if (target > dmaCopied) {
+		memcpy(&memory[DMA_DESTINATION + dmaCopied], &memory[dmaSource + dmaCopied], target - dmaCopied);
+		dmaCopied = target;
+	}
+}
+
+bool Memory::isDMAActive() {
+	return dmaActive;
+}
+
+void Memory::saveState(StateWriter& w) {
+	// Boot ROM, until it is unmapped
+	w.write(memory, 0x100);
+	w.write(&memory[0x8000], getSize(0x8000, 0xFFFF) + 1);
+	w.write(ram, sizeof(ram));
+
+	w.write(isMapped);
+	w.write(isRAMEnabled);
+	w.write(bankMode);
+	w.write(romBank);
+	w.write(ramBank);
+
+	w.write(rtcSelect);
+	w.write(rtcLatch);
+	w.write(rtcRegister, sizeof(rtcRegister));
+	w.write(rtcTime);
+	w.write(rtcBase);
+	w.write(ticks);
+
+	w.write(dmaActive);
+	w.write(dmaSource);
+	w.write(dmaTicks);
+	w.write(dmaCopied);
+}
+
+void Memory::loadState(StateReader& r) {
+	r.read(memory, 0x100);
+	r.read(&memory[0x8000], getSize(0x8000, 0xFFFF) + 1);
+	r.read(ram, sizeof(ram));
+
+	r.read(isMapped);
+	r.read(isRAMEnabled);
+	r.read(bankMode);
+	r.read(romBank);
+	r.read(ramBank);
+
+	r.read(rtcSelect);
+	r.read(rtcLatch);
+	r.read(rtcRegister, sizeof(rtcRegister));
+	r.read(rtcTime);
+	r.read(rtcBase);
+	r.read(ticks);
+
+	r.read(dmaActive);
+	r.read(dmaSource);
+	r.read(dmaTicks);
+	r.read(dmaCopied);
+
+	// The ROM is not part of the state
+	copyFromCartridge(0x100, 0x100, getSize(0x100, 0x4000));
+	switchROMBank(romBank);
+}
+
+void Memory::copyState(const Memory& other) {
+	cartridge = other.cartridge;
+	memcpy(memory, other.memory, sizeof(memory));
+	memcpy(ram, other.ram, sizeof(ram));
+
+	isMapped = other.isMapped;
+	bankingController = other.bankingController;
+	isRAMEnabled = other.isRAMEnabled;
+	bankMode = other.bankMode;
+	romBank = other.romBank;
+	romBankCount = other.romBankCount;
+	ramBank = other.ramBank;
+	memcpy(bankRegister, other.bankRegister, sizeof(bankRegister));
+
+	rtcSelect = other.rtcSelect;
+	rtcLatch = other.rtcLatch;
+	memcpy(rtcRegister, other.rtcRegister, sizeof(rtcRegister));
+	rtcTime = other.rtcTime;
+	rtcBase = other.rtcBase;
+	ticks = other.ticks;
+
+	dmaActive = other.dmaActive;
+	dmaSource = other.dmaSource;
+	dmaTicks = other.dmaTicks;
+	dmaCopied = other.dmaCopied;
+}
+
+uint16_t Memory::getROMChecksum() {
+	return readCartridge16u(0x14E);
+}
+
+uint16_t Memory::getROMBank() {
+	return romBank;
+}
+
+uint16_t Memory::getROMBankCount() {
+	return romBankCount;
+}
+
+unsigned long Memory::getBankSwitches() {
+	return bankSwitches;
+}
+
+void Memory::setWatchpoints(Breakpoints* b, const uint8_t pages[WATCH_PAGES]) {
+	watchpoints = b;
+	for (unsigned int i = 0; i < WATCH_PAGES; i++) {
+		watchPages[i] = pages[i] | (watchPages[i] & WATCH_LOG);
+	}
+}
+
+void Memory::setCodeLog(CodeLog* c) {
+	codeLog = c;
+
+	// The cartridge is mapped to 0x0000-0x7FFF
+	for (unsigned int i = 0; i < 0x80; i++) {
+		watchPages[i] = c ? (watchPages[i] | WATCH_LOG) : (watchPages[i] & ~WATCH_LOG);
+	}
+}
+
+bool Memory::isBootROMMapped() {
+	return !isMapped;
+}
+
+void Memory::notifyWatchpoints(uint16_t addr, uint8_t value, uint8_t access) {
+	uint8_t page = watchPages[addr >> 8];
+	if (access == WATCH_READ && (page & WATCH_LOG)) {
+		codeLog->addRead(addr);
+	}
+	if (page & access) {
+		watchpoints->onAccess(addr, value, access);
 	}
 }
 
 
 /* Read 8bit */
 uint8_t Memory::read_8u(uint16_t addr) {
-	/* Linkport I/O return 0xFF for unused serial interface */
-	if (addr == 0xFF01) {
+	// Pages without watchpoints or code log only pay for the lookup
+	if (watchPages[addr >> 8]) {
+		uint8_t value = readUnwatched(addr);
+		notifyWatchpoints(addr, value, WATCH_READ);
+		return value;
+	}
+	return readUnwatched(addr);
+}
+
+uint8_t Memory::readUnwatched(uint16_t addr) {
+	/* OAM DMA occupies the external bus, only I/O and HRAM are accessible */
+	if (dmaActive && addr < IO_START) {
 		return 0xFF;
 	}
 
+	/* I/O registers with read side effects */
+	if ((uint16_t) (addr - IO_START) < IO_SIZE && ioRead[addr - IO_START] != NULL) {
+		return (this->*ioRead[addr - IO_START])(addr);
+	}
+
 	return memory[addr];
 }
 
@@ -371,17 +658,33 @@ int8_t Memory::read_8s(uint16_t addr) {
 
 /* Write 8bit */
 void Memory::write_8u(uint16_t addr, uint8_t value) {
+	if (dmaActive && addr < IO_START) {
+		return;
+	}
+
+	if (watchPages[addr >> 8] & WATCH_WRITE) {
+		watchpoints->onAccess(addr, value, WATCH_WRITE);
+	}
+
 	// Prevent writing to ROM by MBC and perform bank switch
 	if (isBanking(addr, value)) {
 		return;
 	}
 
+	// Writes to a mapped MBC3 RTC register
+	if (rtcSelect != 0 && addr >= 0xA000 && addr < 0xC000) {
+		writeRTC(value);
+		return;
+	}
+
 	
 	// Write to memory
 	memory[addr] = value;
 
-	// Trigger Events
-	triggerEvent(addr, value);
+	// I/O registers with write side effects
+	if ((uint16_t) (addr - IO_START) < IO_SIZE && ioWrite[addr - IO_START] != NULL) {
+		(this->*ioWrite[addr - IO_START])(addr, value);
+	}
 	
 }
 
@@ -389,31 +692,45 @@ void Memory::privilegedWrite8u(uint16_t addr, uint8_t value) {
 	memory[addr] = value;
 }
 
-/* Read 16bit in correct endianness */
+uint8_t Memory::privilegedRead8u(uint16_t addr) {
+	return memory[addr];
+}
+
+/* Read 16bit in correct endianness, both bytes like 8bit reads: DMA lockout and I/O registers */
 uint16_t Memory::read_16u(uint16_t addr) {
-	return memory[addr+1] << 8 | memory[addr];
+	uint16_t next = addr + 1;
+	uint8_t low = readUnwatched(addr);
+	uint8_t high = readUnwatched(next);
+	if (watchPages[addr >> 8] | watchPages[next >> 8]) {
+		notifyWatchpoints(addr, low, WATCH_READ);
+		notifyWatchpoints(next, high, WATCH_READ);
+	}
+	return high << 8 | low;
 }
 
 int16_t Memory::read_16s(uint16_t addr) {
 	return (int16_t) read_16u(addr);
 }
 
-/* Write 16bit in correct endianess */
+/* Write 16bit in correct endianess, L to addr and H to addr+1 like 8bit writes */
 void Memory::write_16u(uint16_t addr, uint16_t value) {
-	// write L to addr and H to addr+1
-	memory[addr] = (value & 0xFF);
-	memory[addr+1] = (value >> 8);
+	write_8u(addr, value & 0xFF);
+	write_8u(addr + 1, value >> 8);
 }
 
 void Memory::writeCartridge8u(uint32_t addr, uint8_t value) {
 	if (addr <= CARTRIDGE_SIZE) {
-		cartridge[addr] = value;
+		// Copy on write, the cartridge may be shared with clones
+		if (!cartridge.unique()) {
+			cartridge = std::make_shared<std::vector<uint8_t> >(*cartridge);
+		}
+		(*cartridge)[addr] = value;
 	}
 }
 
 uint8_t Memory::readCartridge8u(uint32_t addr) {
 	if (addr <= CARTRIDGE_SIZE) {
-		return cartridge[addr];
+		return (*cartridge)[addr];
 	}
 	else { 
 		return 0x0;
@@ -422,7 +739,7 @@ uint8_t Memory::readCartridge8u(uint32_t addr) {
 
 uint16_t Memory::readCartridge16u(uint32_t addr) {
 	if (addr < CARTRIDGE_SIZE) {
-		return cartridge[addr+1] << 8 | cartridge[addr];
+		return (*cartridge)[addr+1] << 8 | (*cartridge)[addr];
 	}
 	else {
 		return 0x0;
@@ -446,7 +763,7 @@ uint8_t Memory::readRAM8u(uint32_t addr) {
 
 /* Helper Methods */
 void Memory::copyFromCartridge(uint16_t dest, uint32_t src, uint16_t size) {
-	memcpy(&memory[dest], &cartridge[src], size);
+	memcpy(&memory[dest], &(*cartridge)[src], size);
 }
 
 void Memory::copyFromRAM(uint16_t dest, uint16_t src, uint16_t size) {
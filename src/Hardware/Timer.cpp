@@ -1,73 +1,158 @@
 #include "../Component/Timer.h"
 
 #include "../Component/Interrupts.h"
+#include "../Component/SaveState.h"
+#include "../Component/Trace.h"
+
+#include <climits>
 
 
 /* Constructor */
 Timer::Timer(Memory* m) {
     mem = m;
-    currentFreq = 0;
-    timerCounter = 1024;
-    dividerCounter = 0;
+    ticks = 0;
+    divBase = 0;
+    timaStart = 0;
+    timaBase = 0;
+    control = 0;
+    updateDeadline();
+
+    mem->setTimer(this);
 }
 
 bool Timer::isClockEnabled() {
-    return mem->read_8u(TMC) & (1 << 2);
-
+    return control & (1 << 2);
 }
 
 uint8_t Timer::getClockFreq() {
-    return mem->read_8u(TMC) & 0x3;
+    return control & 0x3;
 }
 
-void Timer::setClockFreq() {
-    currentFreq = getClockFreq();
-    switch (currentFreq) {
-        case 0: timerCounter = 1024; break;
-        case 1: timerCounter = 16;   break;
-        case 2: timerCounter = 64;   break;
-        case 3: timerCounter = 256;  break;
+unsigned int Timer::getClockPeriod() {
+    switch (getClockFreq()) {
+        case 0: return 1024;
+        case 1: return 16;
+        case 2: return 64;
+        default: return 256;
     }
 }
 
-void Timer::updateDividerRegister(uint8_t cycles) {
-    dividerCounter += cycles;
-    
-    if (dividerCounter >= 255) {
-        dividerCounter = 0;
-        mem->privilegedWrite8u(DIV, mem->read_8u(DIV)+1);
+/* Internal 16 bit divider, DIV is its upper byte */
+uint16_t Timer::getDivider() {
+    return (uint16_t) (ticks - divBase);
+}
+
+uint8_t Timer::getCounter() {
+    if (!isClockEnabled()) {
+        return timaStart;
     }
+
+    unsigned int period = getClockPeriod();
+    unsigned long increments = (ticks - divBase) / period - (timaBase - divBase) / period;
+    return (uint8_t) (timaStart + increments);
+}
+
+/* Store current TIMA value, before the counting parameters change */
+void Timer::rebaseCounter() {
+    timaStart = getCounter();
+    timaBase = ticks;
 }
 
-void Timer::checkFreqChange() {
-    if (currentFreq != getClockFreq()) {
-        setClockFreq();
+void Timer::updateDeadline() {
+    if (!isClockEnabled()) {
+        overflowDeadline = ULONG_MAX;
+        return;
     }
+
+    unsigned int period = getClockPeriod();
+    unsigned long increments = (timaBase - divBase) / period + (256 - timaStart);
+    overflowDeadline = divBase + increments * period;
+}
+
+void Timer::handleOverflow() {
+    // Reload from TMA exactly at the overflow, not at the end of the instruction
+    timaStart = mem->privilegedRead8u(TMA);
+    timaBase = overflowDeadline;
+    updateDeadline();
+
+    triggerInterrupt();
 }
 
 void Timer::update(uint8_t cycles) {
-    checkFreqChange();
-    updateDividerRegister(cycles);
-
-    if (isClockEnabled()) {
-        timerCounter -= cycles;
-
-        if (timerCounter <= 0) {
-            setClockFreq();
-
-            if (mem->read_8u(TIMA) == 0xFF) {
-                mem->write_8u(TIMA, mem->read_8u(TMA));
-                triggerInterrupt();
-            }
-            else {
-                mem->write_8u(TIMA, mem->read_8u(TIMA)+1);
-            }
-        }
+    ticks += cycles;
+
+    // Only overflows do work, a scope on every call would cost more than the update
+    while (ticks >= overflowDeadline) {
+        TRACE_SCOPE("Timer::update");
+        handleOverflow();
+    }
+}
+
+uint8_t Timer::readRegister(uint16_t addr) {
+    switch (addr) {
+        case DIV:  return getDivider() >> 8;
+        case TIMA: return getCounter();
+        case TMC:  return control;
+        default:   return 0xFF;
     }
 }
 
+void Timer::writeRegister(uint16_t addr, uint8_t value) {
+    switch (addr) {
+        // Writing any value resets the divider
+        case DIV:
+            rebaseCounter();
+            divBase = ticks;
+            break;
+        case TIMA:
+            timaStart = value;
+            timaBase = ticks;
+            break;
+        case TMC:
+            rebaseCounter();
+            control = value;
+            break;
+        default:
+            return;
+    }
+    updateDeadline();
+}
+
+void Timer::setDivider(uint16_t value) {
+    rebaseCounter();
+    divBase = ticks - value;
+    updateDeadline();
+}
+
+void Timer::saveState(StateWriter& w) {
+    w.write(ticks);
+    w.write(divBase);
+    w.write(timaStart);
+    w.write(timaBase);
+    w.write(overflowDeadline);
+    w.write(control);
+}
+
+void Timer::loadState(StateReader& r) {
+    r.read(ticks);
+    r.read(divBase);
+    r.read(timaStart);
+    r.read(timaBase);
+    r.read(overflowDeadline);
+    r.read(control);
+}
+
+void Timer::copyState(const Timer& other) {
+    ticks = other.ticks;
+    divBase = other.divBase;
+    timaStart = other.timaStart;
+    timaBase = other.timaBase;
+    overflowDeadline = other.overflowDeadline;
+    control = other.control;
+}
+
 
 void Timer::triggerInterrupt() {
-	uint8_t current = mem->read_8u(INTERRUPT_REQUEST_REGISTER);
-	mem->write_8u(INTERRUPT_REQUEST_REGISTER, (current | INTERRUPT_TIMER));
-}
\ No newline at end of file
+	uint8_t current = mem->privilegedRead8u(INTERRUPT_REQUEST_REGISTER);
+	mem->privilegedWrite8u(INTERRUPT_REQUEST_REGISTER, (current | INTERRUPT_TIMER));
+}
@@ -0,0 +1,259 @@
+#include "../Component/Breakpoints.h"
+#include "../Component/Config.h"
+#include "../Component/Output.h"
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <strings.h>
+#include <regex>
+
+/* [bank:]start[-end] [if operand op value] */
+static const std::regex SPEC_FORMAT(
+	"^\\s*(?:(?:0x)?([0-9a-f]+):)?(?:0x)?([0-9a-f]+)(?:-(?:0x)?([0-9a-f]+))?"
+	"(?:\\s+if\\s+([a-z]+|\\((?:0x)?[0-9a-f]+\\))\\s*(==|!=|<=|>=|<|>)\\s*(?:0x)?([0-9a-f]+))?\\s*$",
+	std::regex::icase);
+
+static const char* OPERAND_NAMES[] = { "a", "f", "b", "c", "d", "e", "h", "l", "af", "bc", "de", "hl", "sp" };
+static const char* COMPARISON_NAMES[] = { "==", "!=", "<", "<=", ">", ">=" };
+
+/* Constructor */
+Breakpoints::Breakpoints(Memory* m, registers* r) {
+	mem = m;
+	reg = r;
+	nextId = 1;
+	memset(executeMap, 0, sizeof(executeMap));
+	armed = false;
+}
+
+Breakpoints::~Breakpoints() {
+	uint8_t pages[WATCH_PAGES] = {};
+	mem->setWatchpoints(NULL, pages);
+}
+
+/* Methods */
+int Breakpoints::add(const std::string& spec, uint8_t access, bool temporary) {
+	Entry entry;
+	if (!parse(spec, entry)) {
+		return -1;
+	}
+
+	entry.id = nextId++;
+	entry.access = access;
+	entry.temporary = temporary;
+	entries.push_back(entry);
+	update();
+
+	return entry.id;
+}
+
+bool Breakpoints::remove(int id) {
+	for (size_t i = 0; i < entries.size(); i++) {
+		if (entries[i].id == id) {
+			entries.erase(entries.begin() + i);
+			update();
+			return true;
+		}
+	}
+	return false;
+}
+
+void Breakpoints::clear() {
+	entries.clear();
+	update();
+}
+
+void Breakpoints::list() {
+	if (entries.empty()) {
+		printf(YELLOW "No breakpoints or watchpoints set\n" DEFAULT);
+	}
+	for (size_t i = 0; i < entries.size(); i++) {
+		print(entries[i]);
+	}
+}
+
+void Breakpoints::onAccess(uint16_t addr, uint8_t value, uint8_t access) {
+	// Accesses while stepping are the debugger's own or already shown
+	if (Config::isDebug()) {
+		return;
+	}
+
+	for (size_t i = 0; i < entries.size(); i++) {
+		const Entry& entry = entries[i];
+		if (!(entry.access & access) || addr < entry.start || addr > entry.end || !matches(entry, addr)) {
+			continue;
+		}
+
+		printf(YELLOW "Watchpoint %d: %s 0x%02X at 0x%04X [PC: 0x%04X]\n" DEFAULT, entry.id, access == BREAK_READ ? "read" : "write", value, addr, reg->pc);
+		Config::enableDebug();
+		return;
+	}
+}
+
+/* Helper Methods */
+bool Breakpoints::parse(const std::string& spec, Entry& entry) {
+	std::smatch match;
+	if (!std::regex_match(spec, match, SPEC_FORMAT)) {
+		return false;
+	}
+
+	unsigned long start = strtoul(match[2].str().c_str(), NULL, 16);
+	unsigned long end = match[3].matched ? strtoul(match[3].str().c_str(), NULL, 16) : start;
+	if (end > 0xFFFF || start > end) {
+		return false;
+	}
+
+	entry.start = start;
+	entry.end = end;
+	entry.bank = match[1].matched ? (int) strtoul(match[1].str().c_str(), NULL, 16) : -1;
+	entry.operand = OP_NONE;
+	entry.comparison = CMP_EQ;
+	entry.address = 0;
+	entry.value = 0;
+
+	if (match[4].matched) {
+		std::string operand = match[4].str();
+		if (operand[0] == '(') {
+			unsigned long address = strtoul(operand.c_str() + 1, NULL, 16);
+			if (address > 0xFFFF) {
+				return false;
+			}
+			entry.operand = OP_MEMORY;
+			entry.address = address;
+		}
+		else {
+			for (size_t i = 0; i < sizeof(OPERAND_NAMES) / sizeof(OPERAND_NAMES[0]); i++) {
+				if (strcasecmp(operand.c_str(), OPERAND_NAMES[i]) == 0) {
+					entry.operand = (Operand) (OP_A + i);
+				}
+			}
+			if (entry.operand == OP_NONE) {
+				return false;
+			}
+		}
+
+		for (size_t i = 0; i < sizeof(COMPARISON_NAMES) / sizeof(COMPARISON_NAMES[0]); i++) {
+			if (match[5].str() == COMPARISON_NAMES[i]) {
+				entry.comparison = (Comparison) i;
+			}
+		}
+		entry.value = strtoul(match[6].str().c_str(), NULL, 16);
+	}
+
+	return true;
+}
+
+bool Breakpoints::matches(const Entry& entry, uint16_t addr) {
+	if (entry.bank >= 0 && addr >= 0x4000 && addr < 0x8000 && mem->getROMBank() != entry.bank) {
+		return false;
+	}
+	if (entry.operand == OP_NONE) {
+		return true;
+	}
+
+	uint16_t operand = getOperand(entry);
+	switch (entry.comparison) {
+		case CMP_EQ: return operand == entry.value;
+		case CMP_NE: return operand != entry.value;
+		case CMP_LT: return operand < entry.value;
+		case CMP_LE: return operand <= entry.value;
+		case CMP_GT: return operand > entry.value;
+		case CMP_GE: return operand >= entry.value;
+	}
+	return false;
+}
+
+uint16_t Breakpoints::getOperand(const Entry& entry) {
+	switch (entry.operand) {
+		case OP_A: return reg->a;
+		case OP_F: return reg->f;
+		case OP_B: return reg->b;
+		case OP_C: return reg->c;
+		case OP_D: return reg->d;
+		case OP_E: return reg->e;
+		case OP_H: return reg->h;
+		case OP_L: return reg->l;
+		case OP_AF: return reg->af;
+		case OP_BC: return reg->bc;
+		case OP_DE: return reg->de;
+		case OP_HL: return reg->hl;
+		case OP_SP: return reg->sp;
+		// Without side effects of I/O registers
+		case OP_MEMORY: return mem->privilegedRead8u(entry.address);
+		default: return 0;
+	}
+}
+
+bool Breakpoints::checkExecute(uint16_t pc) {
+	for (size_t i = 0; i < entries.size(); i++) {
+		const Entry& entry = entries[i];
+		if (entry.access != BREAK_EXECUTE || pc < entry.start || pc > entry.end || !matches(entry, pc)) {
+			continue;
+		}
+
+		if (entry.temporary) {
+			entries.erase(entries.begin() + i);
+			update();
+		}
+		else {
+			printf(YELLOW "Breakpoint %d [PC: 0x%04X]\n" DEFAULT, entry.id, pc);
+		}
+		return true;
+	}
+	return false;
+}
+
+void Breakpoints::update() {
+	uint8_t pages[WATCH_PAGES] = {};
+	memset(executeMap, 0, sizeof(executeMap));
+	armed = false;
+
+	for (size_t i = 0; i < entries.size(); i++) {
+		const Entry& entry = entries[i];
+		if (entry.access == BREAK_EXECUTE) {
+			for (uint32_t addr = entry.start; addr <= entry.end; addr++) {
+				executeMap[addr >> 6] |= 1ULL << (addr & 63);
+			}
+			armed = true;
+		}
+		else {
+			for (uint32_t page = entry.start >> 8; page <= (uint32_t) (entry.end >> 8); page++) {
+				pages[page] |= entry.access;
+			}
+		}
+	}
+
+	mem->setWatchpoints(this, pages);
+}
+
+void Breakpoints::print(const Entry& entry) {
+	const char* kind = "break";
+	if (entry.access == (BREAK_READ | BREAK_WRITE)) {
+		kind = "watch access";
+	}
+	else if (entry.access == BREAK_READ) {
+		kind = "watch read";
+	}
+	else if (entry.access == BREAK_WRITE) {
+		kind = "watch write";
+	}
+
+	printf(CYAN "[%d]" DEFAULT " %s ", entry.id, kind);
+	if (entry.bank >= 0) {
+		printf("%02X:", entry.bank);
+	}
+	printf("%04X", entry.start);
+	if (entry.end != entry.start) {
+		printf("-%04X", entry.end);
+	}
+	if (entry.operand == OP_MEMORY) {
+		printf(" if (%04X) %s %X", entry.address, COMPARISON_NAMES[entry.comparison], entry.value);
+	}
+	else if (entry.operand != OP_NONE) {
+		printf(" if %s %s %X", OPERAND_NAMES[entry.operand - OP_A], COMPARISON_NAMES[entry.comparison], entry.value);
+	}
+	if (entry.temporary) {
+		printf(" (temporary)");
+	}
+	printf("\n");
+}
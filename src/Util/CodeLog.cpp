@@ -0,0 +1,99 @@
+#include "../Component/CodeLog.h"
+#include "../Component/SaveState.h"
+
+#include <cstdio>
+
+/* Constructor */
+CodeLog::CodeLog(Memory* m) {
+	mem = m;
+	flags.assign((size_t) mem->getROMBankCount() * CODELOG_BANK_SIZE, 0);
+	fetchStart = 0;
+	fetchEnd = 0;
+}
+
+/* Methods */
+bool CodeLog::load(std::string file) {
+	std::vector<uint8_t> previous;
+	if (!SaveState::readFile(file, previous)) {
+		return true;
+	}
+	if (previous.size() != flags.size()) {
+		return false;
+	}
+
+	for (size_t i = 0; i < flags.size(); i++) {
+		flags[i] |= previous[i];
+	}
+	return true;
+}
+
+bool CodeLog::writeFile(std::string file) {
+	// Replace the merged log at once, a failed write keeps the old one
+	std::string tmp = file + ".tmp";
+	if (!SaveState::writeFile(tmp, flags)) {
+		return false;
+	}
+	return rename(tmp.c_str(), file.c_str()) == 0;
+}
+
+void CodeLog::addInstruction(uint16_t pc, uint8_t length, bool extended) {
+	fetchStart = pc;
+	fetchEnd = pc + length;
+
+	long offset = getOffset(pc);
+	if (offset < 0) {
+		return;
+	}
+
+	flags[offset] |= extended ? CODELOG_OPERAND : CODELOG_OPCODE;
+	for (uint8_t i = 1; i < length && getOffset(pc + i) >= 0; i++) {
+		flags[getOffset(pc + i)] |= CODELOG_OPERAND;
+	}
+}
+
+void CodeLog::printStats() {
+	unsigned long opcodes = 0;
+	unsigned long operands = 0;
+	unsigned long data = 0;
+	unsigned long untouched = 0;
+
+	std::string banks;
+	unsigned int touchedBanks = 0;
+	for (size_t bank = 0; bank < flags.size() / CODELOG_BANK_SIZE; bank++) {
+		bool touched = false;
+		for (size_t i = bank * CODELOG_BANK_SIZE; i < (bank + 1) * CODELOG_BANK_SIZE; i++) {
+			opcodes += (flags[i] & CODELOG_OPCODE) != 0;
+			operands += (flags[i] & CODELOG_OPERAND) != 0;
+			data += (flags[i] & CODELOG_DATA) != 0;
+			untouched += flags[i] == 0;
+			touched |= flags[i] != 0;
+		}
+
+		if (touched) {
+			char name[8];
+			snprintf(name, sizeof(name), " %02X", (unsigned int) bank);
+			banks += name;
+			touchedBanks++;
+		}
+	}
+
+	double size = flags.size();
+	printf("== Code log: %.1f%% opcodes, %.1f%% operands, %.1f%% data, %.1f%% untouched\n",
+		100.0 * opcodes / size, 100.0 * operands / size, 100.0 * data / size, 100.0 * untouched / size);
+	printf("== Code log: %u of %lu banks touched:%s\n", touchedBanks, (unsigned long) flags.size() / CODELOG_BANK_SIZE, banks.c_str());
+}
+
+/* Helper Methods */
+long CodeLog::getOffset(uint16_t addr) {
+	long offset = -1;
+	if (addr < CODELOG_BANK_SIZE) {
+		// The boot ROM hides the cartridge until it is unmapped
+		if (addr >= 0x100 || !mem->isBootROMMapped()) {
+			offset = addr;
+		}
+	}
+	else if (addr < 2 * CODELOG_BANK_SIZE) {
+		offset = (long) mem->getROMBank() * CODELOG_BANK_SIZE + addr - CODELOG_BANK_SIZE;
+	}
+	return offset < (long) flags.size() ? offset : -1;
+}
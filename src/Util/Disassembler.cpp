@@ -0,0 +1,280 @@
+#include "../Component/Disassembler.h"
+#include "../Component/Instruction.h"
+#include "../Component/ExtInstruction.h"
+#include "../Component/SaveState.h"
+#include "../Component/CodeLog.h"
+
+#include <cstdio>
+#include <cstring>
+
+/* Output buffer of the listing */
+#define DISASM_WRITE_BUFFER (1 << 16)
+
+/* Constructor */
+Disassembler::Disassembler() {
+	instructions = 0;
+	labels = 0;
+	unresolved = 0;
+	elapsed = std::chrono::steady_clock::duration::zero();
+}
+
+/* Methods */
+bool Disassembler::load(const std::string& file) {
+	if (!SaveState::readFile(file, rom)) {
+		return false;
+	}
+	flags.assign(rom.size(), 0);
+	return true;
+}
+
+void Disassembler::addEntry(uint32_t offset) {
+	if (offset < rom.size()) {
+		pending.push_back(offset);
+	}
+}
+
+bool Disassembler::addCodeLog(const std::string& file) {
+	std::vector<uint8_t> log;
+	if (!SaveState::readFile(file, log) || log.size() != rom.size()) {
+		return false;
+	}
+
+	for (size_t i = 0; i < log.size(); i++) {
+		if (log[i] & CODELOG_OPCODE) {
+			addEntry(i);
+		}
+	}
+	return true;
+}
+
+void Disassembler::run() {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	// Entry point and interrupt vectors, the RST vectors are found through their callers
+	addTarget(0x100);
+	for (uint16_t vector = 0x40; vector <= 0x60; vector += 8) {
+		addTarget(vector);
+	}
+
+	while (!pending.empty()) {
+		uint32_t offset = pending.back();
+		pending.pop_back();
+		trace(offset);
+	}
+
+	elapsed += std::chrono::steady_clock::now() - start;
+}
+
+bool Disassembler::writeFile(const std::string& file) {
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+
+	FILE* fileptr = fopen(file.c_str(), "w");
+	if (fileptr == NULL) {
+		return false;
+	}
+	setvbuf(fileptr, NULL, _IOFBF, DISASM_WRITE_BUFFER);
+
+	uint32_t offset = 0;
+	while (offset < rom.size()) {
+		if (offset % DISASM_BANK_SIZE == 0) {
+			fprintf(fileptr, "\n; Bank 0x%02X\n\n", offset / DISASM_BANK_SIZE);
+		}
+		if (flags[offset] & DISASM_LABEL) {
+			fprintf(fileptr, "L%02X_%04X:\n", offset / DISASM_BANK_SIZE, getAddress(offset));
+		}
+
+		if (flags[offset] & DISASM_OPCODE) {
+			writeInstruction(fileptr, offset);
+			offset += getLength(offset);
+		}
+		else {
+			offset = writeData(fileptr, offset);
+		}
+	}
+
+	bool written = !ferror(fileptr);
+	fclose(fileptr);
+
+	elapsed += std::chrono::steady_clock::now() - start;
+	return written;
+}
+
+void Disassembler::printStats() {
+	unsigned long code = 0;
+	for (size_t i = 0; i < flags.size(); i++) {
+		code += (flags[i] & (DISASM_OPCODE | DISASM_OPERAND)) != 0;
+	}
+
+	printf("== Disassembler: %lu KB in %lu banks, %lu instructions, %.1f%% code, %lu labels, %lu unresolved targets in %.1f ms\n",
+		(unsigned long) rom.size() >> 10, (unsigned long) (rom.size() + DISASM_BANK_SIZE - 1) / DISASM_BANK_SIZE,
+		instructions, rom.empty() ? 0.0 : 100.0 * code / rom.size(), labels, unresolved,
+		std::chrono::duration<double, std::milli>(elapsed).count());
+}
+
+/* Helper Methods */
+long Disassembler::getOffset(int bank, uint16_t addr) {
+	long offset = -1;
+	if (addr < DISASM_BANK_SIZE) {
+		offset = addr;
+	}
+	else if (addr < 2 * DISASM_BANK_SIZE && bank > 0) {
+		offset = (long) bank * DISASM_BANK_SIZE + addr - DISASM_BANK_SIZE;
+	}
+	return offset < (long) rom.size() ? offset : -1;
+}
+
+uint16_t Disassembler::getAddress(uint32_t offset) {
+	return offset < DISASM_BANK_SIZE ? offset : DISASM_BANK_SIZE + offset % DISASM_BANK_SIZE;
+}
+
+uint32_t Disassembler::getLength(uint32_t offset) {
+	uint8_t opcode = rom[offset];
+	return opcode == 0xCB ? 2 : (instruction[opcode].size > 0 ? instruction[opcode].size : 1);
+}
+
+bool Disassembler::getTarget(uint32_t offset, uint16_t& target) {
+	uint8_t opcode = rom[offset];
+
+	// JP, CALL and their conditional forms
+	if (opcode == 0xC3 || opcode == 0xCD || (opcode & 0xE7) == 0xC2 || (opcode & 0xE7) == 0xC4) {
+		target = rom[offset + 1] | (rom[offset + 2] << 8);
+		return true;
+	}
+	// JR and JR cc, relative to the next instruction
+	if (opcode == 0x18 || (opcode & 0xE7) == 0x20) {
+		target = getAddress(offset) + 2 + (int8_t) rom[offset + 1];
+		return true;
+	}
+	// RST
+	if ((opcode & 0xC7) == 0xC7) {
+		target = opcode & 0x38;
+		return true;
+	}
+	return false;
+}
+
+void Disassembler::addTarget(long offset) {
+	// The vectors lie outside of files shorter than a cartridge header
+	if (offset < 0 || offset >= (long) rom.size()) {
+		return;
+	}
+
+	if (!(flags[offset] & DISASM_LABEL)) {
+		flags[offset] |= DISASM_LABEL;
+		labels++;
+	}
+	if (!(flags[offset] & DISASM_OPCODE)) {
+		pending.push_back(offset);
+	}
+}
+
+void Disassembler::trace(uint32_t offset) {
+	int bank = offset / DISASM_BANK_SIZE;
+	uint32_t end = (bank + 1) * DISASM_BANK_SIZE;
+	if (end > rom.size()) {
+		end = rom.size();
+	}
+
+	// Bank 0 reaches 0x4000-0x7FFF through the selected bank, which is fixed with two banks
+	int banks = (rom.size() + DISASM_BANK_SIZE - 1) / DISASM_BANK_SIZE;
+	int selected = bank > 0 ? bank : (banks <= 2 ? 1 : -1);
+	int lastA = -1;
+
+	// Stop at code traced before and at operands of other instructions
+	while (offset < end && !(flags[offset] & (DISASM_OPCODE | DISASM_OPERAND))) {
+		uint8_t opcode = rom[offset];
+		uint32_t length = getLength(offset);
+		if (strcmp(instruction[opcode].name, "UNKNOWN") == 0 || offset + length > end) {
+			break;
+		}
+
+		flags[offset] |= DISASM_OPCODE;
+		for (uint32_t i = 1; i < length; i++) {
+			flags[offset + i] |= DISASM_OPERAND;
+		}
+		instructions++;
+
+		uint16_t target;
+		if (getTarget(offset, target)) {
+			long targetOffset = getOffset(selected, target);
+			if (targetOffset >= 0) {
+				targets[offset] = targetOffset;
+				addTarget(targetOffset);
+			}
+			else {
+				unresolved++;
+			}
+		}
+
+		// LD A, n followed by LD (2000-3FFF), A selects the bank
+		if (opcode == 0x3E) {
+			lastA = rom[offset + 1];
+		}
+		else {
+			if (opcode == 0xEA && bank == 0 && lastA >= 0 && (rom[offset + 2] & 0xE0) == 0x20) {
+				selected = (lastA == 0 ? 1 : lastA) % banks;
+			}
+			lastA = -1;
+		}
+
+		// JP, JR, RET, RETI and JP HL do not continue
+		if (opcode == 0xC3 || opcode == 0x18 || opcode == 0xC9 || opcode == 0xD9 || opcode == 0xE9) {
+			break;
+		}
+		offset += length;
+	}
+}
+
+void Disassembler::writeInstruction(FILE* file, uint32_t offset) {
+	uint8_t opcode = rom[offset];
+	uint32_t length = getLength(offset);
+
+	char text[48];
+	if (opcode == 0xCB) {
+		snprintf(text, sizeof(text), "%s", ext_instruction[rom[offset + 1]].name);
+	}
+	else if (length == 3) {
+		snprintf(text, sizeof(text), instruction[opcode].name, rom[offset + 1] | (rom[offset + 2] << 8));
+	}
+	else {
+		snprintf(text, sizeof(text), instruction[opcode].name, length == 2 ? rom[offset + 1] : 0);
+	}
+
+	char bytes[12] = "";
+	for (uint32_t i = 0; i < length; i++) {
+		snprintf(bytes + 3 * i, sizeof(bytes) - 3 * i, "%02X ", rom[offset + i]);
+	}
+
+	fprintf(file, "    %02X:%04X  %-9s %s", offset / DISASM_BANK_SIZE, getAddress(offset), bytes, text);
+
+	uint16_t target;
+	std::unordered_map<uint32_t, uint32_t>::iterator it = targets.find(offset);
+	if (it != targets.end()) {
+		fprintf(file, "  ; L%02X_%04X", it->second / DISASM_BANK_SIZE, getAddress(it->second));
+	}
+	else if (getTarget(offset, target)) {
+		fprintf(file, target < 2 * DISASM_BANK_SIZE ? "  ; 0x%04X in unknown bank" : "  ; 0x%04X outside of the ROM", target);
+	}
+	fprintf(file, "\n");
+
+	// Jumps into the middle of this instruction
+	for (uint32_t i = 1; i < length; i++) {
+		if (flags[offset + i] & DISASM_LABEL) {
+			fprintf(file, "; L%02X_%04X is inside the instruction above\n", (offset + i) / DISASM_BANK_SIZE, getAddress(offset + i));
+		}
+	}
+}
+
+uint32_t Disassembler::writeData(FILE* file, uint32_t offset) {
+	fprintf(file, "    %02X:%04X  DB 0x%02X", offset / DISASM_BANK_SIZE, getAddress(offset), rom[offset]);
+
+	// Until code, a label or the end of the bank
+	uint32_t end = offset + 1;
+	while (end < rom.size() && end - offset < DISASM_DATA_PER_LINE && end % DISASM_BANK_SIZE != 0 && !(flags[end] & (DISASM_OPCODE | DISASM_LABEL))) {
+		fprintf(file, ", 0x%02X", rom[end]);
+		end++;
+	}
+	fprintf(file, "\n");
+
+	return end;
+}
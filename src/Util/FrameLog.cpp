@@ -0,0 +1,110 @@
+#include "../Component/FrameLog.h"
+
+#include <cstring>
+
+/* Constructor */
+FrameLog::FrameLog() {
+	file = NULL;
+	verifying = false;
+	position = 0;
+	frames = 0;
+	diverged = false;
+}
+
+FrameLog::~FrameLog() {
+	if (file) {
+		fclose(file);
+	}
+}
+
+/* Methods */
+bool FrameLog::open(std::string name, uint8_t mode) {
+	verifying = mode == FRAMELOG_VERIFY;
+	if (!verifying) {
+		file = fopen(name.c_str(), "w");
+		return file != NULL;
+	}
+
+	FILE* fileptr = fopen(name.c_str(), "r");
+	if (fileptr == NULL) {
+		return false;
+	}
+
+	unsigned long frame;
+	unsigned long long value;
+	int fields;
+	while ((fields = fscanf(fileptr, "%lu %llx", &frame, &value)) == 2) {
+		golden.push_back(std::make_pair(frame, (uint64_t) value));
+	}
+	bool complete = fields == EOF && !ferror(fileptr);
+	fclose(fileptr);
+
+	// A gate must not pass on an empty log or on the valid part of a broken one
+	if (!complete) {
+		printf("> Golden log is malformed after %zu frames\n", golden.size());
+		return false;
+	}
+	if (golden.empty()) {
+		printf("> Golden log has no frames\n");
+		return false;
+	}
+	return true;
+}
+
+bool FrameLog::addFrame(uint8_t framebuffer[][WIDTH], unsigned long frame) {
+	uint64_t value = hash(&framebuffer[0][0], HEIGHT * WIDTH);
+	frames++;
+
+	if (!verifying) {
+		fprintf(file, "%lu %016llx\n", frame, (unsigned long long) value);
+		return true;
+	}
+	// Stop like a replayed movie at the end of the golden log
+	if (diverged || position >= golden.size()) {
+		return false;
+	}
+
+	if (golden[position].first != frame) {
+		printf("> Frame %lu rendered, golden log has frame %lu\n", frame, golden[position].first);
+		diverged = true;
+	}
+	else if (golden[position].second != value) {
+		printf("> Frame %lu differs: %016llx, golden %016llx\n", frame, (unsigned long long) value, (unsigned long long) golden[position].second);
+		diverged = true;
+	}
+	else {
+		position++;
+	}
+
+	return !diverged;
+}
+
+bool FrameLog::finish() {
+	if (!verifying) {
+		printf("== Frame log: %lu frames\n", frames);
+		return true;
+	}
+
+	if (!diverged && position < golden.size()) {
+		printf("> Stopped before frame %lu of the golden log\n", golden[position].first);
+		diverged = true;
+	}
+
+	if (diverged) {
+		printf("== Frame log: differs after %zu matching frames\n", position);
+	} else {
+		printf("== Frame log: all %zu frames match\n", position);
+	}
+	return !diverged;
+}
+
+uint64_t FrameLog::hash(const uint8_t* data, size_t size) {
+	uint64_t h = 0xCBF29CE484222325ULL ^ size;
+	for (size_t i = 0; i + 8 <= size; i += 8) {
+		uint64_t word;
+		memcpy(&word, data + i, sizeof(word));
+		h = (h ^ word) * 0x100000001B3ULL;
+		h ^= h >> 29;
+	}
+	return h;
+}
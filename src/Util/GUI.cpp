@@ -1,11 +1,58 @@
 #include "../Component/GUI.h"
 #include "../Component/Config.h"
+#include "../Component/Trace.h"
 #include "../Component/Joypad.h"
 
 #include <SDL2/SDL.h>
 
 #include <iostream>
 #include <unistd.h>
+#include <cstring>
+#include <algorithm>
+
+/* Predefined shades for color number 0-3 in RGBA */
+static const uint32_t PALETTES[PALETTE_COUNT][4] = {
+	{ 0x9CBD0FFF, 0x8CAD0FFF, 0x306230FF, 0x0F380FFF },		// Green
+	{ 0xFFFFFFFF, 0xAAAAAAFF, 0x555555FF, 0x000000FF },		// Gray
+};
+
+/* Overlay font: rows from top, bit 2 is the left pixel */
+static const uint8_t FONT_DIGITS[10][5] = {
+	{ 7, 5, 5, 5, 7 }, { 2, 6, 2, 2, 7 }, { 7, 1, 7, 4, 7 }, { 7, 1, 3, 1, 7 }, { 5, 5, 7, 1, 1 },
+	{ 7, 4, 7, 1, 7 }, { 7, 4, 7, 5, 7 }, { 7, 1, 1, 1, 1 }, { 7, 5, 7, 5, 7 }, { 7, 5, 7, 1, 7 },
+};
+
+static const uint8_t FONT_LETTERS[26][5] = {
+	{ 2, 5, 7, 5, 5 }, { 6, 5, 6, 5, 6 }, { 3, 4, 4, 4, 3 }, { 6, 5, 5, 5, 6 }, { 7, 4, 6, 4, 7 },
+	{ 7, 4, 6, 4, 4 }, { 3, 4, 5, 5, 3 }, { 5, 5, 7, 5, 5 }, { 7, 2, 2, 2, 7 }, { 1, 1, 1, 5, 2 },
+	{ 5, 5, 6, 5, 5 }, { 4, 4, 4, 4, 7 }, { 5, 7, 7, 5, 5 }, { 6, 5, 5, 5, 5 }, { 2, 5, 5, 5, 2 },
+	{ 6, 5, 6, 4, 4 }, { 2, 5, 5, 6, 3 }, { 6, 5, 6, 5, 5 }, { 3, 4, 2, 1, 6 }, { 7, 2, 2, 2, 2 },
+	{ 5, 5, 5, 5, 7 }, { 5, 5, 5, 5, 2 }, { 5, 5, 7, 7, 5 }, { 5, 5, 2, 5, 5 }, { 5, 5, 2, 2, 2 },
+	{ 7, 1, 2, 4, 7 },
+};
+
+static const uint8_t FONT_DOT[5] = { 0, 0, 0, 0, 2 };
+static const uint8_t FONT_SLASH[5] = { 1, 1, 2, 4, 4 };
+static const uint8_t FONT_MINUS[5] = { 0, 0, 7, 0, 0 };
+static const uint8_t FONT_BLANK[5] = { 0, 0, 0, 0, 0 };
+
+static const uint8_t* getGlyph(char c) {
+	if (c >= '0' && c <= '9') {
+		return FONT_DIGITS[c - '0'];
+	}
+	if (c >= 'A' && c <= 'Z') {
+		return FONT_LETTERS[c - 'A'];
+	}
+	if (c >= 'a' && c <= 'z') {
+		return FONT_LETTERS[c - 'a'];
+	}
+	switch (c) {
+		case '.': return FONT_DOT;
+		case '/': return FONT_SLASH;
+		case '-': return FONT_MINUS;
+		default:  return FONT_BLANK;
+	}
+}
 
 /* Constructor */
 GUI::GUI() {
@@ -23,6 +70,16 @@ GUI::GUI() {
 	buttonX = SDLK_n;
 	buttonY = SDLK_m;
 
+	setPalette(getPalette(Config::getColorPalette()));
+	memset(lastFrame, 0, sizeof(lastFrame));
+	forceRedraw = true;
+	overlayLines = 0;
+	overlayDirty = 0;
+
+	buttons = 0;
+	hotkeys = 0;
+	rewindHeld = false;
+
 	SDL_Init(SDL_INIT_VIDEO);
     SDL_CreateWindowAndRenderer(factor * WIDTH, factor * HEIGHT, 0, &window, &renderer);
 
@@ -41,20 +98,56 @@ GUI::~GUI() {
 }
 
 void GUI::render(uint8_t framebuffer[][WIDTH]) {
-	void *pixels;
-	int pitch;
+	TRACE_SCOPE("GUI::render");
+
+	int first = HEIGHT;
+	int last = -1;
+
+	// Convert changed lines only
+	for(int y = 0; y < HEIGHT; y++) {
+		if (!forceRedraw && memcmp(lastFrame[y], framebuffer[y], WIDTH) == 0) {
+			continue;
+		}
+
+		memcpy(lastFrame[y], framebuffer[y], WIDTH);
+		for(int x = 0; x < WIDTH; x++) {
+			pixels[y][x] = palette[framebuffer[y][x] & 0x3];
+		}
 
-	SDL_LockTexture(texture, NULL, &pixels, &pitch);
+		if (first > y) {
+			first = y;
+		}
+		last = y;
+	}
+	forceRedraw = false;
 
-	for(uint y = 0; y < HEIGHT; y++) {
-		uint32_t* dst = (uint32_t*)((uint8_t*)pixels + y * pitch);
-		for(uint x = 0; x < WIDTH; x++) {
-			*dst++ = getColor(framebuffer[y][x]);
+	// Restore the lines under the old text, the new one is drawn below
+	if (overlayDirty > 0) {
+		int lines = std::min(overlayDirty, HEIGHT);
+		for(int y = 0; y < lines; y++) {
+			for(int x = 0; x < WIDTH; x++) {
+				pixels[y][x] = palette[framebuffer[y][x] & 0x3];
+			}
 		}
+		first = 0;
+		last = std::max(last, lines - 1);
+		overlayDirty = 0;
+	}
+
+	// Converted lines under the text lost it, the other lines still have it
+	if (overlayLines > 0 && first < overlayLines * OVERLAY_LINE_HEIGHT + 1) {
+		drawOverlay();
+	}
+
+	// Skip upload and present when nothing changed
+	if (last < 0) {
+		return;
 	}
 
+	SDL_Rect rect = { 0, first, WIDTH, last - first + 1 };
+	SDL_UpdateTexture(texture, &rect, pixels[first], WIDTH * sizeof(uint32_t));
+
 	SDL_RenderCopy(renderer, texture, NULL, NULL);
-	SDL_UnlockTexture(texture);
 	SDL_RenderPresent(renderer);
 }	
 
@@ -77,96 +170,180 @@ uint8_t GUI::getPixelColor(uint8_t b1, uint8_t b2, uint8_t x) {
 }
 
 uint32_t GUI::getColor(uint8_t c) {
-	switch(c) {
-		case 0:
-			return 0x9CBD0FFF;
-		case 1:
-			return 0x8CAD0FFF;
-		case 2:
-			return 0x306230FF;
-		case 3:
-			return 0x0F380FFF;
-		default:
-			return 0x0F380FFF;
+	return palette[c & 0x3];
+}
+
+void GUI::setPalette(const uint32_t colors[4]) {
+	for(int i = 0; i < 4; i++) {
+		palette[i] = colors[i];
+	}
+	forceRedraw = true;
+}
+
+void GUI::setOverlay(const std::string& text) {
+	if (text == overlay) {
+		return;
+	}
+
+	int oldLines = overlayLines;
+	overlay = text;
+	overlayLines = text.empty() ? 0 : 1 + std::count(text.begin(), text.end(), '\n');
+
+	// Only the lines of the old and the new text are uploaded again
+	overlayDirty = std::max(overlayDirty, std::max(oldLines, overlayLines) * OVERLAY_LINE_HEIGHT + 1);
+}
+
+void GUI::drawOverlay() {
+	int line = 0;
+	int column = 0;
+
+	for(size_t i = 0; i < overlay.size(); i++) {
+		if (overlay[i] == '\n') {
+			line++;
+			column = 0;
+			continue;
+		}
+
+		int left = column * OVERLAY_GLYPH_WIDTH;
+		int top = line * OVERLAY_LINE_HEIGHT;
+		column++;
+		if (left + OVERLAY_GLYPH_WIDTH >= WIDTH || top + OVERLAY_LINE_HEIGHT >= HEIGHT) {
+			continue;
+		}
+
+		// Black box with white text, readable on every palette
+		const uint8_t* glyph = getGlyph(overlay[i]);
+		for(int y = 0; y <= OVERLAY_LINE_HEIGHT; y++) {
+			for(int x = 0; x <= OVERLAY_GLYPH_WIDTH; x++) {
+				bool set = y >= 1 && y <= 5 && x >= 1 && x <= 3 && ((glyph[y - 1] >> (3 - x)) & 0x1);
+				pixels[top + y][left + x] = set ? 0xFFFFFFFF : 0x000000FF;
+			}
+		}
 	}
 }
 
+const uint32_t* GUI::getPalette(uint8_t index) {
+	return PALETTES[index % PALETTE_COUNT];
+}
+
 void GUI::handleEvents() {
+	TRACE_SCOPE("GUI::handleEvents");
+
 	SDL_Event event;
 	while(SDL_PollEvent(&event)) {
 		if(event.type == SDL_QUIT) {
-			exit(0);
+			Config::requestQuit();
+		}
+
+		else if(event.type == SDL_WINDOWEVENT) {
+			if(event.window.event == SDL_WINDOWEVENT_EXPOSED) {
+				forceRedraw = true;
+			}
 		}
 
 		else if(event.type == SDL_KEYDOWN) {
-			/* Key P for debugging */
+			/* Key P for debugging, F5 and F8 to save and load state */
 			if(event.key.keysym.sym == SDLK_p) {
-				Config::enableDebug();
-				Config::disableWaiting();
+				hotkeys |= HOTKEY_DEBUG;
+			}
+			else if(event.key.keysym.sym == SDLK_F5) {
+				hotkeys |= HOTKEY_SAVE_STATE;
+			}
+			else if(event.key.keysym.sym == SDLK_F8) {
+				hotkeys |= HOTKEY_LOAD_STATE;
+			}
+			else if(event.key.keysym.sym == SDLK_BACKSPACE) {
+				rewindHeld = true;
 			}
 
 			if(event.key.keysym.sym == buttonA) {
-				Joypad::pressButton(Joypad::Button::A);
+				pressButton(Joypad::Button::A);
 			}
 			else if(event.key.keysym.sym == buttonB) {
-				Joypad::pressButton(Joypad::Button::B);
+				pressButton(Joypad::Button::B);
 			}
 			else if(event.key.keysym.sym == buttonStart) {
-				Joypad::pressButton(Joypad::Button::Start);
+				pressButton(Joypad::Button::Start);
 			}
 			else if(event.key.keysym.sym == buttonSelect) {
-				Joypad::pressButton(Joypad::Button::Select);
+				pressButton(Joypad::Button::Select);
 			}
 			else if(event.key.keysym.sym == buttonUp) {
-				Joypad::pressButton(Joypad::Button::Up);
+				pressButton(Joypad::Button::Up);
 			}
 			else if(event.key.keysym.sym == buttonDown) {
-				Joypad::pressButton(Joypad::Button::Down);
+				pressButton(Joypad::Button::Down);
 			}
 			else if(event.key.keysym.sym == buttonLeft) {
-				Joypad::pressButton(Joypad::Button::Left);
+				pressButton(Joypad::Button::Left);
 			}
 			else if(event.key.keysym.sym == buttonRight) {
-				Joypad::pressButton(Joypad::Button::Right);
+				pressButton(Joypad::Button::Right);
 			}
 			else if(event.key.keysym.sym == buttonX) {
-				Joypad::pressButton(Joypad::Button::X);
+				pressButton(Joypad::Button::X);
 			}
 			else if(event.key.keysym.sym == buttonY) {
-				Joypad::pressButton(Joypad::Button::Y);
+				pressButton(Joypad::Button::Y);
 			}
 		}
 		else if(event.type == SDL_KEYUP) {
+			if(event.key.keysym.sym == SDLK_BACKSPACE) {
+				rewindHeld = false;
+			}
+
 			if(event.key.keysym.sym == buttonA) {
-				Joypad::releaseButton(Joypad::Button::A);
+				releaseButton(Joypad::Button::A);
 			}
 			else if(event.key.keysym.sym == buttonB) {
-				Joypad::releaseButton(Joypad::Button::B);
+				releaseButton(Joypad::Button::B);
 			}
 			else if(event.key.keysym.sym == buttonStart) {
-				Joypad::releaseButton(Joypad::Button::Start);
+				releaseButton(Joypad::Button::Start);
 			}
 			else if(event.key.keysym.sym == buttonSelect) {
-				Joypad::releaseButton(Joypad::Button::Select);
+				releaseButton(Joypad::Button::Select);
 			}
 			else if(event.key.keysym.sym == buttonUp) {
-				Joypad::releaseButton(Joypad::Button::Up);
+				releaseButton(Joypad::Button::Up);
 			}
 			else if(event.key.keysym.sym == buttonDown) {
-				Joypad::releaseButton(Joypad::Button::Down);
+				releaseButton(Joypad::Button::Down);
 			}
 			else if(event.key.keysym.sym == buttonLeft) {
-				Joypad::releaseButton(Joypad::Button::Left);
+				releaseButton(Joypad::Button::Left);
 			}
 			else if(event.key.keysym.sym == buttonRight) {
-				Joypad::releaseButton(Joypad::Button::Right);
+				releaseButton(Joypad::Button::Right);
 			}
 			else if(event.key.keysym.sym == buttonX) {
-				Joypad::releaseButton(Joypad::Button::X);
+				releaseButton(Joypad::Button::X);
 			}
 			else if(event.key.keysym.sym == buttonY) {
-				Joypad::releaseButton(Joypad::Button::Y);
+				releaseButton(Joypad::Button::Y);
 			}
 		}
 	}
-}
\ No newline at end of file
+}
+
+void GUI::pressButton(Joypad::Button b) {
+	buttons |= (1 << static_cast<int>(b));
+}
+
+void GUI::releaseButton(Joypad::Button b) {
+	buttons &= ~(1 << static_cast<int>(b));
+}
+
+uint16_t GUI::getButtons() {
+	return buttons;
+}
+
+uint8_t GUI::takeHotkeys() {
+	uint8_t requested = hotkeys;
+	hotkeys = 0;
+	return requested;
+}
+
+bool GUI::isRewindHeld() {
+	return rewindHeld;
+}
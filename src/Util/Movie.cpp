@@ -0,0 +1,132 @@
+#include "../Component/Movie.h"
+
+#include <stdio.h>
+
+/* Number of Game Boy buttons, without X and Y */
+#define MOVIE_BUTTONS 8
+
+static void writeValue(FILE* fileptr, uint32_t value, int size) {
+	for(int i = 0; i < size; i++) {
+		fputc((value >> (8 * i)) & 0xFF, fileptr);
+	}
+}
+
+static bool readValue(FILE* fileptr, uint32_t* value, int size) {
+	*value = 0;
+	for(int i = 0; i < size; i++) {
+		int c = fgetc(fileptr);
+		if (c == EOF) {
+			return false;
+		}
+		*value |= (uint32_t) c << (8 * i);
+	}
+	return true;
+}
+
+/* Constructor */
+Movie::Movie(bool record) {
+	position = 0;
+	recording = record;
+}
+
+/* Methods */
+bool Movie::update(Joypad* joypad) {
+	if (recording) {
+		uint8_t buttons = 0;
+		for(int i = 0; i < MOVIE_BUTTONS; i++) {
+			buttons |= joypad->buttons[i] << i;
+		}
+		frames.push_back(buttons);
+		return true;
+	}
+
+	if (position >= frames.size()) {
+		return false;
+	}
+
+	joypad->setButtons(frames[position++]);
+	return true;
+}
+
+bool Movie::isRecording() {
+	return recording;
+}
+
+void Movie::stopRecording() {
+	recording = false;
+	position = frames.size();
+}
+
+size_t Movie::getFrameCount() {
+	return frames.size();
+}
+
+void Movie::setStartState(const std::vector<uint8_t>& state) {
+	startState = state;
+}
+
+const std::vector<uint8_t>& Movie::getStartState() {
+	return startState;
+}
+
+bool Movie::writeFile(std::string file) {
+	FILE* fileptr = fopen(file.c_str(), "wb");
+	if (fileptr == NULL) {
+		return false;
+	}
+
+	writeValue(fileptr, MOVIE_MAGIC, 4);
+	writeValue(fileptr, MOVIE_VERSION, 2);
+	writeValue(fileptr, frames.size(), 4);
+	writeValue(fileptr, startState.size(), 4);
+	fwrite(&startState[0], 1, startState.size(), fileptr);
+
+	// Buttons rarely change between frames
+	for(size_t i = 0; i < frames.size();) {
+		size_t run = 1;
+		while (i + run < frames.size() && frames[i + run] == frames[i] && run < 0xFFFF) {
+			run++;
+		}
+		writeValue(fileptr, frames[i], 1);
+		writeValue(fileptr, run, 2);
+		i += run;
+	}
+
+	bool written = !ferror(fileptr);
+	fclose(fileptr);
+
+	return written;
+}
+
+bool Movie::readFile(std::string file) {
+	FILE* fileptr = fopen(file.c_str(), "rb");
+	if (fileptr == NULL) {
+		return false;
+	}
+
+	uint32_t magic = 0, version = 0, count = 0, stateSize = 0;
+	bool valid = readValue(fileptr, &magic, 4) && magic == MOVIE_MAGIC
+		&& readValue(fileptr, &version, 2) && version == MOVIE_VERSION
+		&& readValue(fileptr, &count, 4)
+		&& readValue(fileptr, &stateSize, 4);
+
+	if (valid) {
+		startState.resize(stateSize);
+		valid = stateSize > 0 && fread(&startState[0], 1, stateSize, fileptr) == stateSize;
+	}
+
+	frames.clear();
+	frames.reserve(count);
+	while (valid && frames.size() < count) {
+		uint32_t buttons, run;
+		valid = readValue(fileptr, &buttons, 1) && readValue(fileptr, &run, 2) && run > 0;
+		if (valid) {
+			frames.insert(frames.end(), run, buttons);
+		}
+	}
+
+	fclose(fileptr);
+	position = 0;
+
+	return valid && frames.size() == count;
+}
@@ -0,0 +1,98 @@
+#include "../Component/Presenter.h"
+#include "../Component/Config.h"
+#include "../Component/Joypad.h"
+
+#include <cstring>
+#include <chrono>
+
+/* Constructor */
+Presenter::Presenter() {
+	memset(buffers, 0, sizeof(buffers));
+
+	writeIndex = 0;
+	shared = 1;
+	readIndex = 2;
+
+	buttons = 0;
+	hotkeys = 0;
+	rewindHeld = false;
+	overlayChanged = false;
+
+	running = true;
+	thread = std::thread(&Presenter::loop, this);
+}
+
+Presenter::~Presenter() {
+	running = false;
+	if (thread.joinable()) {
+		thread.join();
+	}
+}
+
+/* Presenter thread: owns SDL for its whole lifetime */
+void Presenter::loop() {
+	GUI* gui = new GUI();
+
+	while(running) {
+		gui->handleEvents();
+		buttons = gui->getButtons();
+		hotkeys |= gui->takeHotkeys();
+		rewindHeld = gui->isRewindHeld();
+
+		if (overlayChanged.exchange(false)) {
+			std::lock_guard<std::mutex> lock(overlayMutex);
+			gui->setOverlay(overlay);
+		}
+
+		// Present the latest completed frame, older ones are dropped
+		if (shared.load(std::memory_order_acquire) & BUFFER_FRESH) {
+			readIndex = shared.exchange(readIndex, std::memory_order_acq_rel) & 0x3;
+			gui->render(buffers[readIndex]);
+		}
+		else {
+			std::this_thread::sleep_for(std::chrono::milliseconds(1));
+		}
+	}
+
+	delete gui;
+}
+
+void Presenter::submitFrame(uint8_t framebuffer[][WIDTH]) {
+	memcpy(buffers[writeIndex], framebuffer, sizeof(buffers[writeIndex]));
+	writeIndex = shared.exchange(writeIndex | BUFFER_FRESH, std::memory_order_acq_rel) & 0x3;
+}
+
+void Presenter::pollInput(Joypad* joypad) {
+	uint16_t current = buttons;
+
+	// Compare with the Joypad, so buttons restored from a state follow the keys again
+	for(int i = 0; i < 10; i++) {
+		bool pressed = (current >> i) & 0x1;
+		if (pressed == joypad->buttons[i]) {
+			continue;
+		}
+		if (pressed) {
+			joypad->pressButton(static_cast<Joypad::Button>(i));
+		} else {
+			joypad->releaseButton(static_cast<Joypad::Button>(i));
+		}
+	}
+
+	uint8_t requested = hotkeys.exchange(0);
+	if (requested & HOTKEY_DEBUG) {
+		Config::enableDebug();
+	}
+	if (requested & HOTKEY_SAVE_STATE) {
+		Config::requestState(STATE_REQUEST_SAVE);
+	}
+	if (requested & HOTKEY_LOAD_STATE) {
+		Config::requestState(STATE_REQUEST_LOAD);
+	}
+	Config::setRewinding(rewindHeld);
+}
+
+void Presenter::setOverlay(const std::string& text) {
+	std::lock_guard<std::mutex> lock(overlayMutex);
+	overlay = text;
+	overlayChanged = true;
+}
@@ -0,0 +1,181 @@
+#include "../Component/Profiler.h"
+#include "../Component/Instruction.h"
+#include "../Component/ExtInstruction.h"
+
+#include <cstdio>
+#include <cstring>
+#include <algorithm>
+
+/* Constructor */
+Profiler::Profiler(uint16_t romBankCount) : rom(romBankCount * 0x4000), ram(0x8000) {
+	memset(opcodes, 0, sizeof(opcodes));
+	haltedCycles = 0;
+
+	// Root of all call paths
+	Node root = { 0, 0, 0 };
+	nodes.push_back(root);
+	current = 0;
+}
+
+/* Methods */
+uint32_t Profiler::getLocation(uint16_t bank, uint16_t pc) {
+	if (pc < 0x4000 || pc >= 0x8000) {
+		return pc;
+	}
+	return (bank << 16) | pc;
+}
+
+void Profiler::addInstruction(uint16_t opcode, uint32_t location, uint8_t ticks) {
+	opcodes[opcode].count++;
+	opcodes[opcode].cycles += ticks;
+
+	Counter& counter = getCounter(location);
+	if (opcode < PROFILER_EXT_OPCODES) {
+		counter.count++;
+	}
+	counter.cycles += ticks;
+
+	nodes[current].cycles += ticks;
+}
+
+void Profiler::addHalted(uint8_t ticks) {
+	haltedCycles += ticks;
+	nodes[current].cycles += ticks;
+}
+
+void Profiler::enter(uint32_t location, uint16_t sp) {
+	if (stack.size() >= PROFILER_MAX_DEPTH) {
+		return;
+	}
+
+	uint64_t key = ((uint64_t) current << 32) | location;
+	std::unordered_map<uint64_t, uint32_t>::iterator it = children.find(key);
+	if (it == children.end()) {
+		Node node = { current, location, 0 };
+		nodes.push_back(node);
+		it = children.insert(std::make_pair(key, (uint32_t) (nodes.size() - 1))).first;
+	}
+
+	Frame frame = { current, sp };
+	stack.push_back(frame);
+	current = it->second;
+}
+
+void Profiler::leave(uint16_t sp) {
+	// Frames below the new stack pointer have lost their return address
+	while (!stack.empty() && stack.back().sp < sp) {
+		current = stack.back().node;
+		stack.pop_back();
+	}
+}
+
+bool Profiler::writeReport(std::string file) {
+	FILE* out = fopen(file.c_str(), "w");
+	if (out == NULL) {
+		return false;
+	}
+
+	uint64_t executed = 0;
+	uint64_t cycles = haltedCycles;
+	std::vector<int> order;
+	for (int i = 0; i < 2 * PROFILER_EXT_OPCODES; i++) {
+		if (i < PROFILER_EXT_OPCODES) {
+			executed += opcodes[i].count;
+		}
+		cycles += opcodes[i].cycles;
+		if (opcodes[i].count) {
+			order.push_back(i);
+		}
+	}
+	double total = cycles > 0 ? cycles / 100.0 : 1;
+
+	fprintf(out, "%llu instructions, %llu cycles, %llu halted (%.2f%%)\n\n",
+		(unsigned long long) executed, (unsigned long long) cycles, (unsigned long long) haltedCycles, haltedCycles / total);
+
+	std::sort(order.begin(), order.end(), [this](int a, int b) { return opcodes[a].cycles > opcodes[b].cycles; });
+	fprintf(out, "Opcode    %-24s %12s %12s %7s\n", "Instruction", "Count", "Cycles", "%");
+	for (size_t i = 0; i < order.size(); i++) {
+		int op = order[i];
+		const instructions& instr = op < PROFILER_EXT_OPCODES ? instruction[op] : ext_instruction[op - PROFILER_EXT_OPCODES];
+		fprintf(out, "%s%02X     %-24s %12llu %12llu %6.2f%%\n", op < PROFILER_EXT_OPCODES ? "   " : "CB ", op & 0xFF, getMnemonic(instr.name).c_str(),
+			(unsigned long long) opcodes[op].count, (unsigned long long) opcodes[op].cycles, opcodes[op].cycles / total);
+	}
+
+	// Locations with the most cycles, ROM locations are stored by physical offset
+	std::vector<std::pair<uint64_t, uint32_t> > hot;
+	for (size_t i = 0; i < rom.size(); i++) {
+		if (rom[i].cycles) {
+			uint32_t location = i < 0x4000 ? i : ((i / 0x4000) << 16) | (0x4000 + i % 0x4000);
+			hot.push_back(std::make_pair(rom[i].cycles, location));
+		}
+	}
+	for (size_t i = 0; i < ram.size(); i++) {
+		if (ram[i].cycles) {
+			hot.push_back(std::make_pair(ram[i].cycles, 0x8000 + i));
+		}
+	}
+	size_t shown = std::min(hot.size(), (size_t) PROFILER_REPORT_LOCATIONS);
+	std::partial_sort(hot.begin(), hot.begin() + shown, hot.end(), std::greater<std::pair<uint64_t, uint32_t> >());
+
+	fprintf(out, "\nLocation  %12s %12s %7s\n", "Count", "Cycles", "%");
+	for (size_t i = 0; i < shown; i++) {
+		uint32_t location = hot[i].second;
+		fprintf(out, "%02X:%04X   %12llu %12llu %6.2f%%\n", location >> 16, location & 0xFFFF,
+			(unsigned long long) getCounter(location).count, (unsigned long long) hot[i].first, hot[i].first / total);
+	}
+
+	fclose(out);
+	return true;
+}
+
+bool Profiler::writeCollapsed(std::string file) {
+	FILE* out = fopen(file.c_str(), "w");
+	if (out == NULL) {
+		return false;
+	}
+
+	for (size_t i = 0; i < nodes.size(); i++) {
+		if (nodes[i].cycles) {
+			fprintf(out, "%s %llu\n", getPath(i).c_str(), (unsigned long long) nodes[i].cycles);
+		}
+	}
+
+	fclose(out);
+	return true;
+}
+
+/* Helper Methods */
+Profiler::Counter& Profiler::getCounter(uint32_t location) {
+	uint16_t pc = location & 0xFFFF;
+	if (pc >= 0x8000) {
+		return ram[pc - 0x8000];
+	}
+	if (pc < 0x4000) {
+		return rom[pc];
+	}
+	return rom[((location >> 16) * 0x4000 + pc - 0x4000) % rom.size()];
+}
+
+/* Instruction name with the operand format replaced by its width, e.g. "JR NZ, d8" */
+std::string Profiler::getMnemonic(const char* name) {
+	std::string mnemonic(name);
+	size_t pos;
+	while ((pos = mnemonic.find("0x%02X")) != std::string::npos) {
+		mnemonic.replace(pos, 6, "d8");
+	}
+	while ((pos = mnemonic.find("0x%04X")) != std::string::npos) {
+		mnemonic.replace(pos, 6, "d16");
+	}
+	return mnemonic;
+}
+
+std::string Profiler::getPath(uint32_t node) {
+	std::string path;
+	while (node != 0) {
+		char name[16];
+		snprintf(name, sizeof(name), ";%02X:%04X", nodes[node].function >> 16, nodes[node].function & 0xFFFF);
+		path = name + path;
+		node = nodes[node].parent;
+	}
+	return "main" + path;
+}
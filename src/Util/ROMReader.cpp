@@ -1,13 +1,8 @@
 #include "../Component/ROMReader.h"
+#include "../Component/Trace.h"
 #include <iostream>
 
-Memory* ROMReader::mem = NULL;
-
-void ROMReader::setMemory(Memory* m) {
-	mem = m;
-}
-
-void ROMReader::copy(string rom) {
+bool ROMReader::copy(Memory* mem, string rom) {
 	FILE *fileptr;
 	long filelen;
 	long i;
@@ -15,6 +10,10 @@ void ROMReader::copy(string rom) {
 
 	fileptr = fopen(rom.c_str(), "rb");
 
+	if(fileptr == NULL) {
+		return false;
+	}
+
 	fseek(fileptr, 0, SEEK_END);
 	filelen = ftell(fileptr);         
 	rewind(fileptr);
@@ -26,9 +25,10 @@ void ROMReader::copy(string rom) {
 	}
 
 	fclose(fileptr);
+	return true;
 }
 
-void ROMReader::load(string rom) {
+void ROMReader::load(Memory* mem, string rom) {
 	FILE *fileptr;
 	long filelen;
 	long i;
@@ -72,7 +72,9 @@ string ROMReader::getRomName(string rom) {
 	return romName;
 }
 
-void ROMReader::dumpSavegame(string file) {
+void ROMReader::dumpSavegame(Memory* mem, string file) {
+	TRACE_SCOPE("ROMReader::dumpSavegame");
+
 	FILE *fileptr;
 	fileptr = fopen(file.c_str(), "wb");
 
@@ -85,7 +87,9 @@ void ROMReader::dumpSavegame(string file) {
 	fclose(fileptr);
 }
 
-bool ROMReader::tryToLoadSavegame(string file) {
+bool ROMReader::tryToLoadSavegame(Memory* mem, string file) {
+	TRACE_SCOPE("ROMReader::tryToLoadSavegame");
+
 	FILE *fileptr;
 	long filelen;
 	long i;
@@ -0,0 +1,229 @@
+#include "../Component/Rewind.h"
+
+#include <cstring>
+
+/* Longest skip or literal run of one chunk */
+#define REWIND_MAX_RUN 0xFFFF
+
+/* Changed bits of a byte compared to base, a NULL base is all zero */
+static inline uint8_t getDiff(const uint8_t* state, const uint8_t* base, size_t i) {
+	return base ? state[i] ^ base[i] : state[i];
+}
+
+static inline bool isWordUnchanged(const uint8_t* state, const uint8_t* base, size_t i) {
+	uint64_t a;
+	uint64_t b = 0;
+	memcpy(&a, state + i, sizeof(a));
+	if (base) {
+		memcpy(&b, base + i, sizeof(b));
+	}
+	return a == b;
+}
+
+/* Constructor */
+Rewind::Rewind(size_t budget, size_t stateSize) : keyState(stateSize, 0) {
+	this->stateSize = stateSize;
+
+	maxEntries = budget / REWIND_ENTRY_RATIO;
+	if (maxEntries < 2) {
+		maxEntries = 2;
+	}
+
+	// The ring has to hold at least two snapshots
+	size_t table = maxEntries * sizeof(Entry);
+	capacity = budget > table ? budget - table : 0;
+	if (capacity < 2 * getMaxEncodedSize()) {
+		capacity = 2 * getMaxEncodedSize();
+	}
+
+	ring = new uint8_t[capacity];
+	entries = new Entry[maxEntries];
+
+	writeOffset = 0;
+	first = 0;
+	count = 0;
+	framesSinceKeyframe = 0;
+}
+
+Rewind::~Rewind() {
+	delete[] ring;
+	delete[] entries;
+}
+
+/* Methods */
+void Rewind::push(const uint8_t* state) {
+	reserve(getMaxEncodedSize());
+
+	// Start with a keyframe, or when the last one was overwritten
+	bool keyframe = count == 0 || framesSinceKeyframe + 1 >= REWIND_KEYFRAME_INTERVAL;
+
+	Entry& entry = entries[(first + count) % maxEntries];
+	entry.offset = writeOffset;
+	entry.keyframe = keyframe;
+	entry.size = encode(state, keyframe ? NULL : &keyState[0], ring + writeOffset);
+
+	writeOffset += entry.size;
+	count++;
+
+	if (keyframe) {
+		memcpy(&keyState[0], state, stateSize);
+		framesSinceKeyframe = 0;
+	} else {
+		framesSinceKeyframe++;
+	}
+}
+
+bool Rewind::pop(uint8_t* state) {
+	if (count == 0) {
+		return false;
+	}
+
+	Entry& entry = getEntry(count - 1);
+	if (entry.keyframe) {
+		memset(state, 0, stateSize);
+	} else {
+		memcpy(state, &keyState[0], stateSize);
+	}
+	decode(entry, state);
+
+	// The newest snapshot ends at writeOffset, so its space is free again
+	count--;
+	writeOffset = entry.offset;
+
+	if (entry.keyframe) {
+		restoreKeyframe();
+	} else {
+		framesSinceKeyframe--;
+	}
+
+	return true;
+}
+
+size_t Rewind::getFrameCount() {
+	return count;
+}
+
+size_t Rewind::getUsedBytes() {
+	size_t used = 0;
+	for (size_t i = 0; i < count; i++) {
+		used += getEntry(i).size;
+	}
+	return used;
+}
+
+/* Helper Methods */
+Rewind::Entry& Rewind::getEntry(size_t index) {
+	return entries[(first + index) % maxEntries];
+}
+
+size_t Rewind::getMaxEncodedSize() {
+	// Every chunk adds 4 bytes, but only the first one and those after a full literal run grow the data
+	return stateSize + 4 * (stateSize / REWIND_MAX_RUN + 2);
+}
+
+void Rewind::dropOldest() {
+	first = (first + 1) % maxEntries;
+	count--;
+}
+
+void Rewind::reserve(size_t size) {
+	// Wrap around, the snapshots left at the end of the ring are the oldest
+	if (writeOffset + size > capacity) {
+		while (count > 0 && getEntry(0).offset >= writeOffset) {
+			dropOldest();
+		}
+		writeOffset = 0;
+	}
+
+	while (count > 0 && getEntry(0).offset >= writeOffset && getEntry(0).offset < writeOffset + size) {
+		dropOldest();
+	}
+	if (count == maxEntries) {
+		dropOldest();
+	}
+
+	// Snapshots cannot be decoded without their keyframe
+	while (count > 0 && !getEntry(0).keyframe) {
+		dropOldest();
+	}
+}
+
+void Rewind::restoreKeyframe() {
+	framesSinceKeyframe = 0;
+
+	for (size_t i = count; i > 0; i--) {
+		Entry& entry = getEntry(i - 1);
+		if (entry.keyframe) {
+			memset(&keyState[0], 0, stateSize);
+			decode(entry, &keyState[0]);
+			framesSinceKeyframe = count - i;
+			return;
+		}
+	}
+}
+
+/*
+    Chunks of: 16 bit unchanged bytes to skip, 16 bit literal length,
+    literal bytes XORed with base. Literals end at REWIND_MIN_SKIP
+    unchanged bytes, so short gaps do not cost a chunk header.
+*/
+size_t Rewind::encode(const uint8_t* state, const uint8_t* base, uint8_t* out) {
+	size_t i = 0;
+	size_t o = 0;
+
+	while (i < stateSize) {
+		size_t skip = 0;
+		while (i + 8 <= stateSize && skip + 8 <= REWIND_MAX_RUN && isWordUnchanged(state, base, i)) {
+			i += 8;
+			skip += 8;
+		}
+		while (i < stateSize && skip < REWIND_MAX_RUN && getDiff(state, base, i) == 0) {
+			i++;
+			skip++;
+		}
+
+		size_t start = i;
+		while (i < stateSize && i - start < REWIND_MAX_RUN) {
+			if (getDiff(state, base, i) == 0 && i + REWIND_MIN_SKIP <= stateSize) {
+				size_t run = 1;
+				while (run < REWIND_MIN_SKIP && getDiff(state, base, i + run) == 0) {
+					run++;
+				}
+				if (run == REWIND_MIN_SKIP) {
+					break;
+				}
+			}
+			i++;
+		}
+
+		size_t length = i - start;
+		out[o++] = skip & 0xFF;
+		out[o++] = skip >> 8;
+		out[o++] = length & 0xFF;
+		out[o++] = length >> 8;
+		for (size_t j = start; j < i; j++) {
+			out[o++] = getDiff(state, base, j);
+		}
+	}
+
+	return o;
+}
+
+void Rewind::decode(const Entry& entry, uint8_t* state) {
+	const uint8_t* in = ring + entry.offset;
+	const uint8_t* end = in + entry.size;
+	size_t pos = 0;
+
+	while (in < end) {
+		size_t skip = in[0] | (in[1] << 8);
+		size_t length = in[2] | (in[3] << 8);
+		in += 4;
+		pos += skip;
+
+		for (size_t j = 0; j < length; j++) {
+			state[pos + j] ^= in[j];
+		}
+		in += length;
+		pos += length;
+	}
+}
@@ -0,0 +1,123 @@
+#include "../Component/SaveState.h"
+
+#include <stdio.h>
+
+/* Largest block before the Adler-32 sums have to be reduced */
+#define ADLER_BLOCK 5552
+#define ADLER_MOD 65521
+
+static void writeHeader32(uint8_t* p, uint32_t value) {
+	p[0] = value & 0xFF;
+	p[1] = (value >> 8) & 0xFF;
+	p[2] = (value >> 16) & 0xFF;
+	p[3] = (value >> 24) & 0xFF;
+}
+
+static uint32_t readHeader32(const uint8_t* p) {
+	return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+void SaveState::begin(std::vector<uint8_t>& buffer) {
+	buffer.assign(STATE_HEADER_SIZE, 0);
+}
+
+void SaveState::finish(std::vector<uint8_t>& buffer, uint16_t romChecksum) {
+	uint8_t* header = &buffer[0];
+	size_t size = buffer.size() - STATE_HEADER_SIZE;
+
+	writeHeader32(header, STATE_MAGIC);
+	header[4] = STATE_VERSION & 0xFF;
+	header[5] = (STATE_VERSION >> 8) & 0xFF;
+	header[6] = romChecksum & 0xFF;
+	header[7] = (romChecksum >> 8) & 0xFF;
+	writeHeader32(header + 8, size);
+	writeHeader32(header + 12, checksum(header + STATE_HEADER_SIZE, size));
+}
+
+const char* SaveState::verify(const std::vector<uint8_t>& buffer, uint16_t romChecksum) {
+	if (buffer.size() < STATE_HEADER_SIZE || readHeader32(&buffer[0]) != STATE_MAGIC) {
+		return "not a save state";
+	}
+
+	const uint8_t* header = &buffer[0];
+	if ((header[4] | (header[5] << 8)) != STATE_VERSION) {
+		return "unsupported version";
+	}
+	if ((header[6] | (header[7] << 8)) != romChecksum) {
+		return "saved from another cartridge";
+	}
+	if (readHeader32(header + 8) != buffer.size() - STATE_HEADER_SIZE) {
+		return "truncated";
+	}
+	if (readHeader32(header + 12) != checksum(getPayload(buffer), getPayloadSize(buffer))) {
+		return "checksum mismatch";
+	}
+
+	return NULL;
+}
+
+const uint8_t* SaveState::getPayload(const std::vector<uint8_t>& buffer) {
+	return &buffer[0] + STATE_HEADER_SIZE;
+}
+
+size_t SaveState::getPayloadSize(const std::vector<uint8_t>& buffer) {
+	return buffer.size() - STATE_HEADER_SIZE;
+}
+
+uint32_t SaveState::checksum(const uint8_t* data, size_t size) {
+	uint32_t a = 1;
+	uint32_t b = 0;
+
+	while (size > 0) {
+		size_t block = size < ADLER_BLOCK ? size : ADLER_BLOCK;
+		size -= block;
+
+		for (size_t i = 0; i < block; i++) {
+			a += data[i];
+			b += a;
+		}
+		data += block;
+
+		a %= ADLER_MOD;
+		b %= ADLER_MOD;
+	}
+
+	return (b << 16) | a;
+}
+
+uint64_t SaveState::hash(const uint8_t* data, size_t size) {
+	uint64_t h = 0xCBF29CE484222325ULL;
+	for (size_t i = 0; i < size; i++) {
+		h = (h ^ data[i]) * 0x100000001B3ULL;
+	}
+	return h;
+}
+
+bool SaveState::writeFile(std::string file, const std::vector<uint8_t>& buffer) {
+	FILE* fileptr = fopen(file.c_str(), "wb");
+	if (fileptr == NULL) {
+		return false;
+	}
+
+	bool written = fwrite(&buffer[0], 1, buffer.size(), fileptr) == buffer.size();
+	fclose(fileptr);
+
+	return written;
+}
+
+bool SaveState::readFile(std::string file, std::vector<uint8_t>& buffer) {
+	FILE* fileptr = fopen(file.c_str(), "rb");
+	if (fileptr == NULL) {
+		return false;
+	}
+
+	fseek(fileptr, 0, SEEK_END);
+	long filelen = ftell(fileptr);
+	rewind(fileptr);
+
+	buffer.resize(filelen > 0 ? filelen : 0);
+	bool read = filelen > 0 && fread(&buffer[0], 1, filelen, fileptr) == (size_t) filelen;
+	fclose(fileptr);
+
+	return read;
+}
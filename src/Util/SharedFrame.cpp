@@ -0,0 +1,132 @@
+#include "../Component/SharedFrame.h"
+#include "../Component/Config.h"
+#include "../Component/Joypad.h"
+
+#include <cstring>
+#include <new>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/* Constructor */
+SharedFrame::SharedFrame() {
+	layout = NULL;
+	owner = false;
+}
+
+SharedFrame::~SharedFrame() {
+	if (layout) {
+		munmap(layout, sizeof(SharedFrameLayout));
+	}
+	if (owner) {
+		shm_unlink(name.c_str());
+	}
+}
+
+/* Methods */
+bool SharedFrame::create(std::string name) {
+	if (!map(name, true)) {
+		return false;
+	}
+
+	// The atomics are lock free, so they work in memory shared between processes
+	new (layout) SharedFrameLayout();
+	layout->magic = SHARED_FRAME_MAGIC;
+	layout->version = SHARED_FRAME_VERSION;
+	layout->width = SHARED_FRAME_WIDTH;
+	layout->height = SHARED_FRAME_HEIGHT;
+	layout->sequence = 0;
+	layout->frame = 0;
+	memset(layout->pixels, 0, sizeof(layout->pixels));
+	layout->buttons = 0;
+	layout->quit = 0;
+
+	owner = true;
+	return true;
+}
+
+bool SharedFrame::attach(std::string name) {
+	if (!map(name, false)) {
+		return false;
+	}
+	if (layout->magic != SHARED_FRAME_MAGIC || layout->version != SHARED_FRAME_VERSION) {
+		munmap(layout, sizeof(SharedFrameLayout));
+		layout = NULL;
+		return false;
+	}
+	return true;
+}
+
+void SharedFrame::publishFrame(uint8_t framebuffer[][SHARED_FRAME_WIDTH], uint64_t frame) {
+	uint32_t sequence = layout->sequence.load(std::memory_order_relaxed);
+
+	// Odd while writing, the fence keeps the pixels from being written before
+	layout->sequence.store(sequence + 1, std::memory_order_relaxed);
+	std::atomic_thread_fence(std::memory_order_release);
+
+	memcpy(layout->pixels, framebuffer, sizeof(layout->pixels));
+	layout->frame = frame;
+
+	layout->sequence.store(sequence + 2, std::memory_order_release);
+}
+
+void SharedFrame::pollInput(Joypad* joypad) {
+	// X and Y trigger host functions, only the Game Boy buttons are taken
+	joypad->setButtons(layout->buttons.load(std::memory_order_relaxed) & 0xFF);
+
+	if (layout->quit.load(std::memory_order_relaxed)) {
+		Config::requestQuit();
+	}
+}
+
+uint64_t SharedFrame::readFrame(uint8_t pixels[][SHARED_FRAME_WIDTH]) {
+	for(;;) {
+		uint32_t before = layout->sequence.load(std::memory_order_acquire);
+		if (before & 0x1) {
+			continue;
+		}
+
+		memcpy(pixels, layout->pixels, sizeof(layout->pixels));
+		uint64_t frame = layout->frame;
+
+		std::atomic_thread_fence(std::memory_order_acquire);
+		if (layout->sequence.load(std::memory_order_relaxed) == before) {
+			return frame;
+		}
+	}
+}
+
+void SharedFrame::setButtons(uint16_t buttons) {
+	layout->buttons.store(buttons, std::memory_order_relaxed);
+}
+
+void SharedFrame::requestQuit() {
+	layout->quit.store(1, std::memory_order_relaxed);
+}
+
+/* Helper Methods */
+bool SharedFrame::map(std::string name, bool create) {
+	this->name = name;
+
+	int fd = shm_open(name.c_str(), create ? O_CREAT | O_RDWR : O_RDWR, 0600);
+	if (fd < 0) {
+		return false;
+	}
+	if (create && ftruncate(fd, sizeof(SharedFrameLayout)) != 0) {
+		close(fd);
+		shm_unlink(name.c_str());
+		return false;
+	}
+
+	void* p = mmap(NULL, sizeof(SharedFrameLayout), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+	close(fd);
+	if (p == MAP_FAILED) {
+		if (create) {
+			shm_unlink(name.c_str());
+		}
+		return false;
+	}
+
+	layout = static_cast<SharedFrameLayout*>(p);
+	return true;
+}
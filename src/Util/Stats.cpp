@@ -0,0 +1,128 @@
+#include "../Component/Stats.h"
+#include "../Component/Memory.h"
+#include "../Component/CPU.h"
+
+#include <cstdio>
+#include <cmath>
+#include <algorithm>
+
+/* Constructor */
+Stats::Stats() {
+	frameStart = std::chrono::steady_clock::now();
+	lastFrame = frameStart;
+
+	frames = 0;
+	periodFrames = 0;
+	periodLate = 0;
+	periodTime = 0;
+	lastInstructions = 0;
+	lastBankSwitches = 0;
+	periodInstructions = 0;
+	periodBankSwitches = 0;
+
+	speed = 0;
+	p50 = 0;
+	p95 = 0;
+	p99 = 0;
+	jitter = 0;
+	lateFrames = 0;
+	instructionsPerFrame = 0;
+	bankSwitchesPerFrame = 0;
+}
+
+/* Methods */
+void Stats::finishFrame(unsigned long instructions, unsigned long bankSwitches) {
+	std::chrono::steady_clock::time_point now = std::chrono::steady_clock::now();
+
+	double interval = std::chrono::duration<double, std::milli>(now - lastFrame).count();
+	frameTimes[frames % STATS_WINDOW] = std::chrono::duration<double, std::milli>(now - frameStart).count();
+	intervals[frames % STATS_WINDOW] = interval;
+	lastFrame = now;
+	frames++;
+
+	periodFrames++;
+	periodTime += interval;
+	periodInstructions += instructions - lastInstructions;
+	periodBankSwitches += bankSwitches - lastBankSwitches;
+	lastInstructions = instructions;
+	lastBankSwitches = bankSwitches;
+}
+
+bool Stats::finishPacing(bool late) {
+	frameStart = std::chrono::steady_clock::now();
+	periodLate += late;
+
+	if (periodFrames < STATS_REPORT_FRAMES) {
+		return false;
+	}
+	report();
+	return true;
+}
+
+std::string Stats::getOverlay() {
+	char text[96];
+	snprintf(text, sizeof(text), "SPEED %.2f LATE %u JIT %.1f\nMS %.1f/%.1f/%.1f IPF %.0f BANK %.0f",
+		speed, lateFrames, jitter, p50, p95, p99, instructionsPerFrame, bankSwitchesPerFrame);
+	return text;
+}
+
+bool Stats::writeFile(std::string file) {
+	std::string tmp = file + ".tmp";
+	FILE* out = fopen(tmp.c_str(), "w");
+	if (out == NULL) {
+		return false;
+	}
+
+	fprintf(out, "gbemu_frames %lu\n", frames);
+	fprintf(out, "gbemu_speed_ratio %.4f\n", speed);
+	fprintf(out, "gbemu_frame_time_ms{quantile=\"0.5\"} %.3f\n", p50);
+	fprintf(out, "gbemu_frame_time_ms{quantile=\"0.95\"} %.3f\n", p95);
+	fprintf(out, "gbemu_frame_time_ms{quantile=\"0.99\"} %.3f\n", p99);
+	fprintf(out, "gbemu_frame_jitter_ms %.3f\n", jitter);
+	fprintf(out, "gbemu_late_frames %u\n", lateFrames);
+	fprintf(out, "gbemu_instructions_per_frame %.1f\n", instructionsPerFrame);
+	fprintf(out, "gbemu_bank_switches_per_frame %.2f\n", bankSwitchesPerFrame);
+
+	bool written = fclose(out) == 0;
+	return written && rename(tmp.c_str(), file.c_str()) == 0;
+}
+
+/* Helper Methods */
+void Stats::report() {
+	// Emulated time of the period over host time
+	double emulated = periodFrames * (1000.0 * TICKS_PER_FRAME / CLOCK_RATE);
+	speed = periodTime > 0 ? emulated / periodTime : 0;
+	lateFrames = periodLate;
+	instructionsPerFrame = (double) periodInstructions / periodFrames;
+	bankSwitchesPerFrame = (double) periodBankSwitches / periodFrames;
+
+	p50 = getPercentile(0.5);
+	p95 = getPercentile(0.95);
+	p99 = getPercentile(0.99);
+
+	size_t count = std::min(frames, (unsigned long) STATS_WINDOW);
+	double sum = 0;
+	double squares = 0;
+	for (size_t i = 0; i < count; i++) {
+		sum += intervals[i];
+		squares += intervals[i] * intervals[i];
+	}
+	double mean = sum / count;
+	jitter = std::sqrt(std::max(0.0, squares / count - mean * mean));
+
+	periodFrames = 0;
+	periodLate = 0;
+	periodTime = 0;
+	periodInstructions = 0;
+	periodBankSwitches = 0;
+}
+
+double Stats::getPercentile(double p) {
+	size_t count = std::min(frames, (unsigned long) STATS_WINDOW);
+	double sorted[STATS_WINDOW];
+	std::copy(frameTimes, frameTimes + count, sorted);
+
+	size_t index = std::min(count - 1, (size_t) (p * count));
+	std::nth_element(sorted, sorted + index, sorted + count);
+	return sorted[index];
+}
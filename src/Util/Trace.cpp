@@ -0,0 +1,73 @@
+#include "../Component/Trace.h"
+
+#include <cstdio>
+#include <chrono>
+
+std::atomic<bool> Trace::enabled(false);
+std::mutex Trace::mutex;
+std::vector<Trace::Buffer*> Trace::buffers;
+
+void Trace::enable() {
+	enabled = true;
+}
+
+uint64_t Trace::now() {
+	static const std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+	return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count() + 1;
+}
+
+void Trace::add(const char* name, uint64_t start, uint64_t end) {
+	Buffer* buffer = getBuffer();
+	Event event = { name, start, end - start };
+
+	// Only contended while the trace is written
+	std::lock_guard<std::mutex> lock(buffer->mutex);
+	buffer->events[buffer->count % TRACE_BUFFER_EVENTS] = event;
+	buffer->count++;
+}
+
+bool Trace::writeFile(std::string file) {
+	enabled = false;
+
+	FILE* out = fopen(file.c_str(), "w");
+	if (out == NULL) {
+		return false;
+	}
+
+	fprintf(out, "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[");
+	bool first = true;
+
+	std::lock_guard<std::mutex> lock(mutex);
+	for (size_t i = 0; i < buffers.size(); i++) {
+		Buffer* buffer = buffers[i];
+		std::lock_guard<std::mutex> bufferLock(buffer->mutex);
+
+		size_t begin = buffer->count > TRACE_BUFFER_EVENTS ? buffer->count - TRACE_BUFFER_EVENTS : 0;
+		for (size_t j = begin; j < buffer->count; j++) {
+			const Event& event = buffer->events[j % TRACE_BUFFER_EVENTS];
+			fprintf(out, "%s\n{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f}",
+				first ? "" : ",", event.name, buffer->thread, event.start / 1000.0, event.duration / 1000.0);
+			first = false;
+		}
+	}
+
+	fprintf(out, "\n]}\n");
+	fclose(out);
+	return true;
+}
+
+/* Helper Methods */
+Trace::Buffer* Trace::getBuffer() {
+	// Buffers live until exit, threads may still record while the trace is written
+	static thread_local Buffer* buffer = NULL;
+	if (buffer == NULL) {
+		buffer = new Buffer();
+		buffer->events.resize(TRACE_BUFFER_EVENTS);
+		buffer->count = 0;
+
+		std::lock_guard<std::mutex> lock(mutex);
+		buffer->thread = buffers.size() + 1;
+		buffers.push_back(buffer);
+	}
+	return buffer;
+}
@@ -0,0 +1,202 @@
+#include "../Component/VecEnv.h"
+#include "../Component/Config.h"
+
+#include <cstring>
+#include <cstdio>
+
+/* Frames to wait for the boot ROM before giving up */
+#define VECENV_BOOT_FRAMES 600
+
+/* Constructor */
+VecEnv::VecEnv(std::string bootRom, std::string rom, size_t count, unsigned int threads) {
+	// Machines run as fast as possible, pacing is global
+	Config::setSpeed(0);
+
+	initial = new Emulator(true);
+	initial->load(bootRom, rom);
+	initial->initialize();
+
+	for(int i = 0; i < VECENV_BOOT_FRAMES && initial->getMemory()->privilegedRead8u(0xFF50) != 1; i++) {
+		initial->runFrame();
+	}
+
+	for(size_t i = 0; i < count; i++) {
+		envs.push_back(initial->clone());
+	}
+
+	actions = NULL;
+	observations = NULL;
+	repeat = 1;
+	resetting = false;
+	nextEnv = 0;
+
+	generation = 0;
+	busyWorkers = 0;
+	stopping = false;
+
+	steps = 0;
+	stepTime = std::chrono::steady_clock::duration::zero();
+
+	if (threads == 0) {
+		threads = std::thread::hardware_concurrency();
+	}
+	if (threads > count) {
+		threads = count;
+	}
+
+	// The calling thread is the first worker
+	for(unsigned int i = 1; i < threads; i++) {
+		workers.push_back(std::thread(&VecEnv::workerLoop, this));
+	}
+}
+
+VecEnv::~VecEnv() {
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		stopping = true;
+	}
+	batchStarted.notify_all();
+	for(size_t i = 0; i < workers.size(); i++) {
+		workers[i].join();
+	}
+
+	for(size_t i = 0; i < envs.size(); i++) {
+		delete envs[i];
+	}
+	delete initial;
+}
+
+/* Methods */
+void VecEnv::setRAMObservation(const std::vector<uint16_t>& addresses) {
+	ramAddresses = addresses;
+}
+
+size_t VecEnv::getObservationSize() {
+	return VECENV_SCREEN_SIZE + ramAddresses.size();
+}
+
+size_t VecEnv::getCount() {
+	return envs.size();
+}
+
+unsigned int VecEnv::getThreadCount() {
+	return workers.size() + 1;
+}
+
+void VecEnv::reset(uint8_t* observations) {
+	this->observations = observations;
+	resetting = true;
+	runBatch();
+	resetting = false;
+}
+
+void VecEnv::resetEnv(size_t index, uint8_t* observation) {
+	envs[index]->copyFrom(*initial);
+	if (observation) {
+		writeObservation(index, observation);
+	}
+}
+
+void VecEnv::step(const uint8_t* actions, uint8_t* observations, unsigned int repeat) {
+	std::chrono::steady_clock::time_point begin = std::chrono::steady_clock::now();
+
+	this->actions = actions;
+	this->observations = observations;
+	this->repeat = repeat > 0 ? repeat : 1;
+	runBatch();
+
+	stepTime += std::chrono::steady_clock::now() - begin;
+	steps += envs.size() * this->repeat;
+}
+
+Emulator* VecEnv::getEnv(size_t index) {
+	return envs[index];
+}
+
+void VecEnv::printStats() {
+	double seconds = std::chrono::duration<double>(stepTime).count();
+	double rate = seconds > 0 ? steps / seconds : 0;
+	printf("== VecEnv: %lu env-steps in %.2f s, %.0f env-steps/s, %.0f per core on %u threads\n",
+		steps, seconds, rate, rate / getThreadCount(), getThreadCount());
+}
+
+/* Helper Methods */
+void VecEnv::runBatch() {
+	nextEnv = 0;
+	{
+		std::lock_guard<std::mutex> lock(mutex);
+		busyWorkers = workers.size();
+		generation++;
+	}
+	batchStarted.notify_all();
+
+	work();
+
+	std::unique_lock<std::mutex> lock(mutex);
+	batchFinished.wait(lock, [this] { return busyWorkers == 0; });
+}
+
+void VecEnv::workerLoop() {
+	unsigned long seen = 0;
+
+	for(;;) {
+		{
+			std::unique_lock<std::mutex> lock(mutex);
+			batchStarted.wait(lock, [this, seen] { return stopping || generation != seen; });
+			if (stopping) {
+				return;
+			}
+			seen = generation;
+		}
+
+		work();
+
+		std::lock_guard<std::mutex> lock(mutex);
+		if (--busyWorkers == 0) {
+			batchFinished.notify_one();
+		}
+	}
+}
+
+void VecEnv::work() {
+	for(;;) {
+		size_t index = nextEnv.fetch_add(1);
+		if (index >= envs.size()) {
+			return;
+		}
+
+		if (resetting) {
+			resetEnv(index, observations ? observations + index * getObservationSize() : NULL);
+		} else {
+			stepEnv(index);
+		}
+	}
+}
+
+void VecEnv::stepEnv(size_t index) {
+	Emulator* env = envs[index];
+	GPU* gpu = env->getCPU()->getGPU();
+
+	env->setButtons(actions[index]);
+
+	// Repeated frames are only emulated, the observation needs the last one
+	gpu->setRendering(false);
+	for(unsigned int i = 1; i < repeat; i++) {
+		env->runFrame();
+	}
+	gpu->setRendering(true);
+	env->runFrame();
+
+	writeObservation(index, observations + index * getObservationSize());
+}
+
+void VecEnv::writeObservation(size_t index, uint8_t* out) {
+	Emulator* env = envs[index];
+	memcpy(out, env->getFrameBuffer(), VECENV_SCREEN_SIZE);
+
+	// Raw memory, independent of a running OAM DMA and without watchpoints or code log
+	Memory* mem = env->getMemory();
+	for(size_t i = 0; i < ramAddresses.size(); i++) {
+		out[VECENV_SCREEN_SIZE + i] = mem->privilegedRead8u(ramAddresses[i]);
+	}
+}
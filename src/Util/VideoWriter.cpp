@@ -0,0 +1,234 @@
+#include "../Component/VideoWriter.h"
+#include "../Component/Config.h"
+#include "../Component/Memory.h"
+#include "../Component/CPU.h"
+
+#include <cstring>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <fcntl.h>
+#include <unistd.h>
+
+/* Constructor */
+VideoWriter::VideoWriter() {
+	submitted = 0;
+	written = 0;
+	dropped = 0;
+	discarded = 0;
+
+	file = NULL;
+	format = VIDEO_RAW;
+	palette = NULL;
+
+	output = NULL;
+	outputSize = 0;
+
+	running = false;
+}
+
+VideoWriter::~VideoWriter() {
+	close();
+}
+
+/* Methods */
+bool VideoWriter::open(std::string name, uint8_t format, uint16_t frameSkip) {
+	// A reader closing the pipe fails the write with EPIPE instead of ending the emulator
+	signal(SIGPIPE, SIG_IGN);
+
+	this->name = name;
+	file = openFile();
+	if (file == NULL && errno != ENXIO) {
+		return false;
+	}
+
+	this->format = format;
+	palette = GUI::getPalette(Config::getColorPalette());
+
+	switch (format) {
+		case VIDEO_RGBA:
+			outputSize = HEIGHT * WIDTH * 4;
+			break;
+		case VIDEO_Y4M:
+			outputSize = Y4M_FRAME_HEADER_SIZE + HEIGHT * WIDTH * 3;
+			header = "YUV4MPEG2 W" + std::to_string(WIDTH) + " H" + std::to_string(HEIGHT) + " F" + std::to_string(CLOCK_RATE) + ":" +
+				std::to_string(TICKS_PER_FRAME * (frameSkip > 0 ? frameSkip : 1)) + " Ip A1:1 C444\n";
+			break;
+		default:
+			outputSize = HEIGHT * WIDTH;
+			break;
+	}
+	output = new uint8_t[outputSize];
+
+	// Full range BT.601 of the four palette colors
+	for(int i = 0; i < 4; i++) {
+		double r = palette[i] >> 24;
+		double g = (palette[i] >> 16) & 0xFF;
+		double b = (palette[i] >> 8) & 0xFF;
+		yuv[i][0] = (uint8_t) (0.299 * r + 0.587 * g + 0.114 * b + 0.5);
+		yuv[i][1] = (uint8_t) (128 - 0.168736 * r - 0.331264 * g + 0.5 * b + 0.5);
+		yuv[i][2] = (uint8_t) (128 + 0.5 * r - 0.418688 * g - 0.081312 * b + 0.5);
+	}
+	if (format == VIDEO_Y4M) {
+		memcpy(output, "FRAME\n", Y4M_FRAME_HEADER_SIZE);
+	}
+
+	running = true;
+	thread = std::thread(&VideoWriter::loop, this);
+	return true;
+}
+
+void VideoWriter::close() {
+	if (!thread.joinable()) {
+		return;
+	}
+
+	running = false;
+	wake.notify_one();
+	thread.join();
+
+	if (file) {
+		fclose(file);
+		file = NULL;
+	}
+	delete[] output;
+	output = NULL;
+}
+
+void VideoWriter::submitFrame(uint8_t framebuffer[][WIDTH]) {
+	unsigned long index = submitted.load(std::memory_order_relaxed);
+	if (index - written.load(std::memory_order_acquire) >= VIDEO_QUEUE_SIZE) {
+		dropped++;
+		return;
+	}
+
+	memcpy(queue[index % VIDEO_QUEUE_SIZE], framebuffer, sizeof(queue[0]));
+	submitted.store(index + 1, std::memory_order_release);
+	wake.notify_one();
+}
+
+void VideoWriter::printStats() {
+	printf("== Video: %lu frames written, %lu dropped\n", written.load() - discarded.load(), dropped + discarded.load());
+}
+
+uint8_t VideoWriter::parseFormat(std::string name) {
+	if (name == "raw") {
+		return VIDEO_RAW;
+	}
+	if (name == "rgba") {
+		return VIDEO_RGBA;
+	}
+	if (name == "y4m") {
+		return VIDEO_Y4M;
+	}
+	return 0xFF;
+}
+
+/* Writer thread */
+FILE* VideoWriter::openFile() {
+	int fd = ::open(name.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_NONBLOCK, 0644);
+	if (fd < 0) {
+		return NULL;
+	}
+
+	// Only the open must not wait for a reader, writes block on the writer thread
+	fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_NONBLOCK);
+	FILE* opened = fdopen(fd, "wb");
+	if (opened == NULL) {
+		::close(fd);
+	}
+	return opened;
+}
+
+void VideoWriter::loop() {
+	bool closed = false;
+	bool headerWritten = false;
+
+	for(;;) {
+		{
+			// The emulation thread notifies without the lock, so do not wait forever
+			std::unique_lock<std::mutex> lock(mutex);
+			wake.wait_for(lock, std::chrono::milliseconds(10), [this] {
+				return !running || written.load() != submitted.load(std::memory_order_acquire);
+			});
+		}
+
+		bool stopping = !running;
+
+		// Wait for the reader of a named pipe, the queue fills up and further frames are dropped meanwhile
+		if (file == NULL && !closed) {
+			file = openFile();
+			if (file == NULL && errno != ENXIO) {
+				closed = true;
+				printf("> Cannot open video, frames are dropped\n");
+			}
+		}
+		if (file != NULL && !headerWritten) {
+			// A failure shows up with the first frame
+			fwrite(header.data(), 1, header.size(), file);
+			headerWritten = true;
+		}
+		if (file == NULL && !closed && !stopping) {
+			std::this_thread::sleep_for(std::chrono::milliseconds(10));
+			continue;
+		}
+
+		unsigned long index = written.load(std::memory_order_relaxed);
+		while (index != submitted.load(std::memory_order_acquire)) {
+			if (!closed && file != NULL) {
+				convert(queue[index % VIDEO_QUEUE_SIZE]);
+				if (fwrite(output, 1, outputSize, file) != outputSize) {
+					closed = true;
+					printf(errno == EPIPE ? "> Video reader closed the pipe, frames are dropped\n" : "> Cannot write video, frames are dropped\n");
+				}
+			}
+			// Keep taking frames after an error, they are counted as dropped
+			if (closed || file == NULL) {
+				discarded++;
+			}
+			written.store(++index, std::memory_order_release);
+		}
+
+		if (stopping) {
+			if (file != NULL) {
+				fflush(file);
+			}
+			return;
+		}
+	}
+}
+
+void VideoWriter::convert(uint8_t framebuffer[][WIDTH]) {
+	if (format == VIDEO_RAW) {
+		for(int y = 0; y < HEIGHT; y++) {
+			for(int x = 0; x < WIDTH; x++) {
+				output[y * WIDTH + x] = framebuffer[y][x] & 0x3;
+			}
+		}
+		return;
+	}
+
+	if (format == VIDEO_RGBA) {
+		uint8_t* out = output;
+		for(int y = 0; y < HEIGHT; y++) {
+			for(int x = 0; x < WIDTH; x++) {
+				uint32_t color = palette[framebuffer[y][x] & 0x3];
+				*out++ = color >> 24;
+				*out++ = (color >> 16) & 0xFF;
+				*out++ = (color >> 8) & 0xFF;
+				*out++ = color & 0xFF;
+			}
+		}
+		return;
+	}
+
+	// Y4M: one plane per component after the frame header
+	for(int plane = 0; plane < 3; plane++) {
+		uint8_t* out = output + Y4M_FRAME_HEADER_SIZE + plane * HEIGHT * WIDTH;
+		for(int y = 0; y < HEIGHT; y++) {
+			for(int x = 0; x < WIDTH; x++) {
+				*out++ = yuv[framebuffer[y][x] & 0x3][plane];
+			}
+		}
+	}
+}
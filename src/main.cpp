@@ -1,9 +1,16 @@
 #include <iostream>
+#include <cstdlib>
 
-#include "Component/CPU.h"
-#include "Component/Memory.h"
-#include "Component/ROMReader.h"
+#include "Component/Emulator.h"
 #include "Component/Config.h"
+#include "Component/VecEnv.h"
+#include "Component/VideoWriter.h"
+#include "Component/FrameLog.h"
+#include "Component/Trace.h"
+#include "Component/Disassembler.h"
+
+/* Frames every machine runs in the VecEnv benchmark */
+#define BENCHMARK_FRAMES 1800
 
 using namespace std;
 
@@ -11,27 +18,161 @@ int main( int argc, const char* argv[] )
 {
 	
 	std::string romName;
-	if( argc == 3 && string(argv[2]) == "d") {
-		Config::enableDebug();
+	size_t benchmarkEnvs = 0;
+	std::string disassemblyFile;
+	if (argc >= 2 && argv[1] != NULL) {
 		romName = string(argv[1]);
-	} else if (argc == 2 && argv[1] != NULL ) {
-	 	romName = string(argv[1]);
 	} else {
 		printf("Please specify a valid ROM!\n");
 		exit(0);
 	}
 
+	// Parse options following the ROM
+	for (int i = 2; i < argc; i++) {
+		string option = string(argv[i]);
+		if (option == "d") {
+			Config::enableDebug();
+		}
+		else if (option == "-B" && i+1 < argc) {
+			// Stop in the debugger at [bank:]addr, optionally with a condition
+			Config::addBreakpoint(argv[++i]);
+		}
+		else if (option == "-f" && i+1 < argc) {
+			// Render one of every N frames, 0 disables rendering
+			Config::setFrameSkip(atoi(argv[++i]));
+		}
+		else if (option == "-s" && i+1 < argc) {
+			// Speed multiplier, 0 runs unlimited
+			Config::setSpeed(atof(argv[++i]));
+		}
+		else if (option == "-r" && i+1 < argc) {
+			// Memory for the rewind history in MB, 0 disables rewinding
+			Config::setRewindBudget((size_t) atoi(argv[++i]) << 20);
+		}
+		else if (option == "-a" && i+1 < argc) {
+			// Emulate N frames ahead to reduce input latency
+			Config::setRunAhead(atoi(argv[++i]));
+		}
+		else if (option == "-b") {
+			// Start from the cached state after the boot ROM
+			Config::enableBootCache();
+		}
+		else if (option == "-m" && i+1 < argc) {
+			// Record the input of every frame
+			Config::setMovie(argv[++i], MOVIE_RECORD);
+		}
+		else if (option == "-M" && i+1 < argc) {
+			// Replay recorded input headless and as fast as possible
+			Config::setMovie(argv[++i], MOVIE_REPLAY);
+			Config::setSpeed(0);
+		}
+		else if (option == "-S" && i+1 < argc) {
+			// Share frames and input with other processes instead of a window
+			Config::setSharedFrame(argv[++i]);
+		}
+		else if (option == "-v" && i+2 < argc) {
+			// Stream rendered frames as raw, rgba or y4m to a file or named pipe
+			uint8_t format = VideoWriter::parseFormat(argv[++i]);
+			if (format == 0xFF) {
+				printf("Unknown video format '%s'!\n", argv[i]);
+				exit(0);
+			}
+			Config::setVideo(argv[++i], format);
+		}
+		else if (option == "-h" && i+1 < argc) {
+			// Write the hash of every rendered frame
+			Config::setFrameLog(argv[++i], FRAMELOG_WRITE);
+		}
+		else if (option == "-H" && i+1 < argc) {
+			// Compare every rendered frame with a golden hash log
+			Config::setFrameLog(argv[++i], FRAMELOG_VERIFY);
+		}
+		else if (option == "-P" && i+1 < argc) {
+			// Profile the guest code, FILE.folded gets the call paths for flame graphs
+			Config::setProfileFile(argv[++i]);
+		}
+		else if (option == "-t" && i+1 < argc) {
+			// Trace host time per phase, the newest events are written at exit
+			Config::setTraceFile(argv[++i]);
+			Trace::enable();
+		}
+		else if (option == "-C" && i+1 < argc) {
+			// Mark executed and read cartridge bytes, merged over runs
+			Config::setCodeLogFile(argv[++i]);
+		}
+		else if (option == "-o") {
+			// Show speed and frame times over the game
+			Config::enableOverlay();
+		}
+		else if (option == "-O" && i+1 < argc) {
+			// Rewrite speed and frame times to a file every emulated second
+			Config::setStatsFile(argv[++i]);
+		}
+		else if (option == "-D" && i+1 < argc) {
+			// Disassemble the whole cartridge instead of running it
+			disassemblyFile = argv[++i];
+		}
+		else if (option == "-e" && i+1 < argc) {
+			// Step N headless machines in parallel and print the throughput
+			benchmarkEnvs = atoi(argv[++i]);
+		}
+		else if (option == "-p" && i+1 < argc) {
+			// Select color palette: 0 = green, 1 = gray
+			Config::setColorPalette(atoi(argv[++i]));
+		}
+		else {
+			printf("Unknown option '%s'!\n", option.c_str());
+			exit(0);
+		}
+	}
+
+	// Frames run ahead are rolled back and the real ones are not rendered, so there are none to share or log
+	if (Config::getRunAhead() > 0 && (!Config::getSharedFrame().empty() || !Config::getFrameLogFile().empty())) {
+		printf("Run-ahead cannot be combined with -S, -h or -H!\n");
+		exit(0);
+	}
+
+	if (!disassemblyFile.empty()) {
+		Disassembler disassembler;
+		if (!disassembler.load(romName)) {
+			printf("Cannot read ROM '%s'!\n", romName.c_str());
+			exit(0);
+		}
+		if (!Config::getCodeLogFile().empty() && !disassembler.addCodeLog(Config::getCodeLogFile())) {
+			printf("Cannot use code log '%s'!\n", Config::getCodeLogFile().c_str());
+			exit(0);
+		}
+		disassembler.run();
+		if (!disassembler.writeFile(disassemblyFile)) {
+			printf("Cannot write '%s'!\n", disassemblyFile.c_str());
+			exit(0);
+		}
+		disassembler.printStats();
+		exit(0);
+	}
+
+	if (benchmarkEnvs > 0) {
+		VecEnv envs("../ROM/GB_ROM.bin", romName, benchmarkEnvs);
+		std::vector<uint8_t> actions(benchmarkEnvs, 0);
+		std::vector<uint8_t> observations(benchmarkEnvs * envs.getObservationSize());
 
-	cout << "Starting Gameboy Emulator" << endl;
-	Memory* mem = new Memory();
-	CPU cpu(mem);
+		envs.reset(&observations[0]);
+		for (int frame = 0; frame < BENCHMARK_FRAMES; frame++) {
+			// Change the buttons every few frames, so the machines diverge
+			for (size_t i = 0; i < benchmarkEnvs; i++) {
+				actions[i] = (frame / 8 + i) & 0xFF;
+			}
+			envs.step(&actions[0], &observations[0]);
+		}
+		envs.printStats();
+		exit(0);
+	}
 
-	ROMReader::setMemory(mem);
-	cout << "Copying Boot ROM..." << endl;
-	ROMReader::copy("../ROM/GB_ROM.bin");
+	cout << "Starting Gameboy Emulator" << endl;
+	Emulator emulator(Config::getMovieMode() == MOVIE_REPLAY || !Config::getSharedFrame().empty());
 
-	cout << "Loading Cartridge..." << endl;
-	ROMReader::load(romName);
+	cout << "Loading Boot ROM and Cartridge..." << endl;
+	emulator.load("../ROM/GB_ROM.bin", romName);
 	//r.load("../ROM/Wario Land - Super Mario Land 3 (World).gb");
 	//r.load("../ROM/Motorcross Maniacs.gb");	
 	//r.load("../ROM/Super Mario Land 2 - 6 Golden Coins (USA, Europe).gb");
@@ -59,18 +200,21 @@ int main( int argc, const char* argv[] )
 
 	if( argc == 2 && string(argv[1]) == "c") {
 		Config::enableDebug();
+		emulator.getMemory()->initialize();
 		for(;;) {
-			cpu.disassemble();
+			emulator.getCPU()->disassemble();
 		}
 		exit(0);
 	}
 
 	if( argc == 2 && string(argv[1]) == "w") {
+		emulator.getMemory()->initialize();
 		for(int i = 0; i < 10000; i++) {
-			cpu.disassemble();
+			emulator.getCPU()->disassemble();
 		}
 		exit(0);
 	}
 	
-	cpu.run();
+	// Fails regression runs with -H
+	return emulator.run() ? 0 : 1;
 }
\ No newline at end of file